@@ -29,11 +29,15 @@ namespace Graphics
 		// bool _isMinimized; // TODO: Define use cases!
 
 		unsigned long _glClearFlags;
+		bool _visible = true;
 
 		void SetupWindow()
 		{
 			OpenGL::InitGLFW();
 
+			// a hidden window still has a context, for runs without a display
+			glfwWindowHint(GLFW_VISIBLE, _visible ? GLFW_TRUE : GLFW_FALSE);
+
 			_window = glfwCreateWindow(_width, _height, _title.c_str(), NULL, NULL);
 			glfwSetWindowTitle(_window, _title.c_str());
 
@@ -133,6 +137,12 @@ namespace Graphics
 			//glEnable(GL_SCISSOR_TEST);
 		}
 
+		// takes effect when the window is created, e.g. by SetWindowed
+		void SetVisible(bool visible)
+		{
+			_visible = visible;
+		}
+
 		void SetWindowed(AspectRatio aspect)
 		{
 			_width = aspect.GetWidth();
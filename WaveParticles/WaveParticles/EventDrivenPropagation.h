@@ -0,0 +1,650 @@
+///
+/// Event-Driven Propagation
+///
+/// CPU alternative to the transform feedback propagation pass. A wave
+/// particle moves in a straight line from (Origin, TimeAtOrigin) at constant
+/// velocity, and its amplitude decays exponentially, so everything that can
+/// happen to it is known the moment it is created or reflected:
+///   - wall hit:    first crossing of the domain border [-1, 1] x [-1, 1]
+///   - shore hit:   first land field along the path, sphere traced through
+///                  the signed distance field of the shoreline (optional)
+///   - subdivision: when the dispersion rule of the propagation shader fires,
+///                  dispersionAngle * pathLength > radius * subdivisionRadiusFactor
+///   - death:       when the damped amplitude falls below deletionAmplitude
+///
+/// Every particle stores the earliest of these, and a ParticleEventQueue
+/// hands out the events in time order. Advancing the simulation only touches
+/// the particles whose event fired; all others do no work at all. Positions
+/// and amplitudes for rendering are evaluated in closed form.
+///
+/// Subdivision only ever adds particles. Far from the camera, where the
+/// subdivided wave front is finer than a few pixels, UpdateLevelOfDetail
+/// merges the branches of a subdivision back into one particle, as long as
+/// none of them has been reflected since. Held back from subdividing until
+/// the camera comes closer, the merged particle continues the front with
+/// the summed amplitude.
+///
+/// Speed changes over shallow water are not modelled here, only by the
+/// transform feedback pass.
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "Particle.h"
+#include "SimulationUniforms.h"
+#include "SignedDistanceField.h"
+#include "ParticleEventQueue.h"
+
+
+namespace Simulation
+{
+	enum ParticleEventType
+	{
+		PARTICLE_EVENT_NONE = 0,
+		PARTICLE_EVENT_WALL,
+		PARTICLE_EVENT_SHORE,
+		PARTICLE_EVENT_SUBDIVIDE,
+		PARTICLE_EVENT_DIE
+	};
+
+	static constexpr uint32_t NO_PARTICLE_FAMILY = 0xFFFFFFFF;
+
+	// the particles created by one subdivision, see UpdateLevelOfDetail
+	struct ParticleFamily
+	{
+		uint32_t Parent;        // family of the subdivided particle
+		int8_t ParentBranch;    // ... and its branch within it
+		bool ParentCoherent;    // ... and whether it was still on its front
+		uint8_t Members;        // alive particles of this family
+		uint8_t Children;       // families with this one as their Parent
+	};
+
+	// camera parameters for level of detail
+	struct LevelOfDetailView
+	{
+		glm::mat4 ViewProjection;
+		glm::vec2 Viewport;       // in pixels
+		GLfloat MapSize;          // the domain [-1, 1]^2 covers [0, MapSize]^2 in world space
+		GLfloat MinPixelSpacing;  // finer wave fronts are merged
+	};
+
+	struct EventParticle
+	{
+		glm::vec2 Origin;          // position at TimeAtOrigin
+		double TimeAtOrigin;
+		glm::vec2 Direction;       // unit vector of the propagation angle
+		GLfloat DispersionAngle;
+		GLfloat Velocity;
+		GLfloat Amplitude;         // signed, at TimeAtOrigin
+		GLfloat Radius;
+		GLfloat Travelled;         // path length before TimeAtOrigin, for dispersion
+
+		double EventTime;
+		ParticleEventType Event;
+		glm::vec2 EventNormal;     // for wall and shore hits
+		uint32_t Generation;       // outdates queued events, see ParticleEventQueue
+		uint8_t ShoreContacts;     // consecutive shore hits without moving
+		bool Alive;
+
+		uint32_t Family;           // subdivision this particle came from
+		int8_t Branch;             // 0 continues the parent, +-n fan out
+		bool Coherent;             // not reflected since, still on the family front
+		bool HoldSubdivision;      // merged, until the camera comes closer
+
+		glm::vec2 PositionAt(double time) const
+		{
+			return Origin + Direction * (Velocity * (GLfloat)(time - TimeAtOrigin));
+		}
+
+		GLfloat AmplitudeAt(double time, GLfloat dampingCoefficient) const
+		{
+			return Amplitude * std::exp(-dampingCoefficient * (GLfloat)(time - TimeAtOrigin));
+		}
+
+		GLfloat PathLengthAt(double time) const
+		{
+			return Travelled + Velocity * (GLfloat)(time - TimeAtOrigin);
+		}
+
+		// moves the origin to `time`, the path itself does not change
+		void Rebase(double time, GLfloat dampingCoefficient)
+		{
+			Travelled = PathLengthAt(time);
+			Amplitude = AmplitudeAt(time, dampingCoefficient);
+			Origin = PositionAt(time);
+			TimeAtOrigin = time;
+		}
+	};
+
+	class EventDrivenPropagation
+	{
+	private:
+		static constexpr double NEVER = std::numeric_limits<double>::infinity();
+
+		// particles bouncing between shore fields without moving are absorbed
+		static constexpr uint8_t MAX_SHORE_CONTACTS = 4;
+
+		int _subdivisionBranches;
+		SimulationParameters _parameters;
+		const Terrain::SignedDistanceField* _shore = nullptr;
+
+		std::vector<EventParticle> _particles; // slots, dead ones are reused
+		std::vector<uint32_t> _freeSlots;
+		size_t _numAlive = 0;
+
+		std::vector<ParticleFamily> _families; // indexed by EventParticle::Family
+		std::vector<uint32_t> _freeFamilies;
+
+		ParticleEventQueue _queue;
+		double _time = 0.0;
+		size_t _eventsProcessed = 0;
+
+		uint32_t allocateSlot()
+		{
+			if (!_freeSlots.empty())
+			{
+				uint32_t slot = _freeSlots.back();
+				_freeSlots.pop_back();
+				return slot;
+			}
+			_particles.emplace_back();
+			_particles.back().Generation = 0;
+			return (uint32_t)(_particles.size() - 1);
+		}
+
+		// a family is reused once it has neither members nor child families,
+		// which may in turn release its parent
+		void releaseFamily(uint32_t index)
+		{
+			while (index != NO_PARTICLE_FAMILY)
+			{
+				const ParticleFamily& family = _families[index];
+				if (family.Members != 0 || family.Children != 0) return;
+				_freeFamilies.push_back(index);
+				index = family.Parent;
+				if (index != NO_PARTICLE_FAMILY) _families[index].Children--;
+			}
+		}
+
+		void leaveFamily(EventParticle& particle)
+		{
+			const uint32_t index = particle.Family;
+			if (index == NO_PARTICLE_FAMILY) return;
+			_families[index].Members--;
+			particle.Family = NO_PARTICLE_FAMILY;
+			releaseFamily(index);
+		}
+
+		void kill(uint32_t slot)
+		{
+			EventParticle& particle = _particles[slot];
+			leaveFamily(particle);
+			particle.Alive = false;
+			particle.Generation++;
+			_freeSlots.push_back(slot);
+			_numAlive--;
+		}
+
+		// (time, wall normal) of the first crossing of the domain border
+		static double findWallHit(const EventParticle& particle, glm::vec2& normal)
+		{
+			double hit = NEVER;
+			for (int axis = 0; axis < 2; axis++)
+			{
+				GLfloat speed = particle.Velocity * particle.Direction[axis];
+				if (speed == 0.0f) continue;
+
+				GLfloat wall = (speed > 0.0f) ? 1.0f : -1.0f;
+				double time = std::max(0.0, (double)((wall - particle.Origin[axis]) / speed));
+				if (time < hit)
+				{
+					hit = time;
+					normal = glm::vec2(0.0f);
+				}
+				if (time <= hit) normal[axis] = -wall; // both in a corner
+			}
+			return particle.TimeAtOrigin + hit;
+		}
+
+		// (distance in simulation units, gradient) of the nearest field
+		glm::vec3 sampleShore(glm::vec2 position) const
+		{
+			const int size = _shore->GetSize();
+			int x = std::clamp((int)((position.x * 0.5f + 0.5f) * size), 0, size - 1);
+			int y = std::clamp((int)((position.y * 0.5f + 0.5f) * size), 0, size - 1);
+			glm::vec2 gradient = _shore->GetGradient(x, y);
+			return glm::vec3(_shore->GetDistance(x, y) * 2.0f / size, gradient);
+		}
+
+		// sphere traces the path up to `maxTime`. Returns the time of the last
+		// position in water before land, and the shore normal there. Returns
+		// the origin time if the particle starts on land.
+		double findShoreHit(const EventParticle& particle, double maxTime,
+			glm::vec2& normal) const
+		{
+			if (_shore == nullptr || particle.Velocity == 0.0f) return NEVER;
+
+			// nearest sampling is off by up to half a field diagonal
+			const GLfloat fieldSize = 2.0f / _shore->GetSize();
+			const GLfloat margin = 0.75f * fieldSize;
+			const GLfloat minStep = 0.5f * fieldSize;
+			const GLfloat maxLength = (maxTime == NEVER) ? 4.0f
+				: particle.Velocity * (GLfloat)(maxTime - particle.TimeAtOrigin);
+
+			GLfloat lastWater = 0.0f;
+			for (GLfloat length = 0.0f; length <= maxLength; )
+			{
+				glm::vec3 sample = sampleShore(particle.Origin + particle.Direction * length);
+				if (sample.x < 0.0f)
+				{
+					normal = glm::vec2(sample.y, sample.z);
+					return particle.TimeAtOrigin + lastWater / particle.Velocity;
+				}
+				lastWater = length;
+				length += std::max(sample.x - margin, minStep);
+			}
+			return NEVER;
+		}
+
+		// finds and queues the next event of the particle in `slot`
+		void schedule(uint32_t slot)
+		{
+			EventParticle& particle = _particles[slot];
+			particle.Generation++;
+			particle.Event = PARTICLE_EVENT_NONE;
+			particle.EventTime = NEVER;
+
+			auto consider = [&particle](double time, ParticleEventType event)
+			{
+				if (time < particle.EventTime)
+				{
+					particle.EventTime = time;
+					particle.Event = event;
+				}
+			};
+
+			// death first, such that it wins ties
+			const GLfloat amplitude = std::abs(particle.Amplitude);
+			if (amplitude < _parameters.deletionAmplitude)
+			{
+				consider(particle.TimeAtOrigin, PARTICLE_EVENT_DIE);
+			}
+			else if (_parameters.dampingCoefficient > 0.0f)
+			{
+				consider(particle.TimeAtOrigin + std::log(amplitude / _parameters.deletionAmplitude)
+					/ _parameters.dampingCoefficient, PARTICLE_EVENT_DIE);
+			}
+
+			if (particle.DispersionAngle > 0.0f && particle.Velocity > 0.0f &&
+				!particle.HoldSubdivision && _parameters.subdivisionEnabled != 0.0f)
+			{
+				GLfloat length = particle.Radius * _parameters.subdivisionRadiusFactor
+					/ particle.DispersionAngle;
+				consider(particle.TimeAtOrigin + std::max(0.0f, length - particle.Travelled)
+					/ particle.Velocity, PARTICLE_EVENT_SUBDIVIDE);
+			}
+
+			glm::vec2 wallNormal;
+			double wallTime = findWallHit(particle, wallNormal);
+
+			glm::vec2 shoreNormal;
+			double shoreTime = findShoreHit(particle, std::min(wallTime, particle.EventTime),
+				shoreNormal);
+
+			if (wallTime < particle.EventTime)
+			{
+				consider(wallTime, PARTICLE_EVENT_WALL);
+				particle.EventNormal = wallNormal;
+			}
+			if (shoreTime < particle.EventTime)
+			{
+				consider(shoreTime, PARTICLE_EVENT_SHORE);
+				particle.EventNormal = shoreNormal;
+			}
+
+			if (particle.Event != PARTICLE_EVENT_NONE)
+			{
+				_queue.Push({ particle.EventTime, slot, particle.Generation });
+			}
+		}
+
+		void subdivide(uint32_t slot)
+		{
+			// the parent continues along its direction, the branches fan out
+			// to either side, each covering an equal part of the old wave front
+			const GLfloat fraction = 1.0f / (GLfloat)_subdivisionBranches;
+			EventParticle& parent = _particles[slot];
+			parent.DispersionAngle *= fraction;
+			parent.Amplitude *= fraction;
+
+			uint32_t family;
+			if (!_freeFamilies.empty())
+			{
+				family = _freeFamilies.back();
+				_freeFamilies.pop_back();
+			}
+			else
+			{
+				family = (uint32_t)_families.size();
+				_families.emplace_back();
+			}
+			_families[family] = { parent.Family, parent.Branch, parent.Coherent,
+				(uint8_t)_subdivisionBranches, 0 };
+
+			// the parent moves into the new family, which keeps the old one alive
+			if (parent.Family != NO_PARTICLE_FAMILY) _families[parent.Family].Children++;
+			leaveFamily(parent);
+			parent.Family = family;
+			parent.Branch = 0;
+			parent.Coherent = true;
+
+			// the wave front is centred on the (unfolded) point of emission
+			const glm::vec2 centre = parent.Origin - parent.Direction * parent.Travelled;
+			const EventParticle branchTemplate = parent;
+			for (int branch = 1; branch <= _subdivisionBranches / 2; branch++)
+			{
+				for (GLfloat side : { 1.0f, -1.0f })
+				{
+					const GLfloat angle = side * branch * branchTemplate.DispersionAngle;
+					const glm::mat2 rotation(std::cos(angle), std::sin(angle),
+						-std::sin(angle), std::cos(angle));
+
+					uint32_t child = allocateSlot();
+					EventParticle& particle = _particles[child];
+					uint32_t generation = particle.Generation;
+					particle = branchTemplate;
+					particle.Generation = generation;
+					particle.Branch = (int8_t)(side * branch);
+					particle.Direction = rotation * branchTemplate.Direction;
+					particle.Origin = glm::clamp(
+						centre + rotation * (branchTemplate.Origin - centre), -1.0f, 1.0f);
+					particle.ShoreContacts = 0;
+					particle.Alive = true;
+					_numAlive++;
+					schedule(child);
+				}
+			}
+			schedule(slot);
+		}
+
+		void fire(const ParticleEvent& event)
+		{
+			EventParticle& particle = _particles[event.Particle];
+			if (!particle.Alive || particle.Generation != event.Generation) return;
+			_eventsProcessed++;
+
+			const bool moved = event.Time > particle.TimeAtOrigin;
+			particle.Rebase(event.Time, _parameters.dampingCoefficient);
+
+			switch (particle.Event)
+			{
+			case PARTICLE_EVENT_WALL:
+				// reflect the components facing the walls that were hit
+				particle.Origin = glm::clamp(particle.Origin, -1.0f, 1.0f);
+				if (particle.EventNormal.x != 0.0f) particle.Direction.x = -particle.Direction.x;
+				if (particle.EventNormal.y != 0.0f) particle.Direction.y = -particle.Direction.y;
+				particle.Coherent = false;
+				schedule(event.Particle);
+				break;
+
+			case PARTICLE_EVENT_SHORE:
+				particle.ShoreContacts = moved ? 0 : particle.ShoreContacts + 1;
+				if (_parameters.terrainReflection == 0.0f ||
+					particle.ShoreContacts > MAX_SHORE_CONTACTS)
+				{
+					kill(event.Particle);
+					break;
+				}
+				// without a usable normal, go back the way we came
+				if (glm::dot(particle.Direction, particle.EventNormal) < 0.0f)
+				{
+					particle.Direction = glm::reflect(particle.Direction, particle.EventNormal);
+				}
+				else
+				{
+					particle.Direction = -particle.Direction;
+				}
+				particle.Coherent = false;
+				schedule(event.Particle);
+				break;
+
+			case PARTICLE_EVENT_SUBDIVIDE:
+				subdivide(event.Particle);
+				break;
+
+			case PARTICLE_EVENT_DIE:
+				kill(event.Particle);
+				break;
+
+			default:
+				break;
+			}
+		}
+
+	public:
+		EventDrivenPropagation(int subdivisionBranches, const SimulationParameters& parameters)
+			: _subdivisionBranches(subdivisionBranches), _parameters(parameters)
+		{
+		}
+
+		// removes all particles, the simulation continues from `time`
+		void Clear(double time)
+		{
+			_particles.clear();
+			_freeSlots.clear();
+			_families.clear();
+			_freeFamilies.clear();
+			_numAlive = 0;
+			_queue.Reset(time);
+			_time = time;
+		}
+
+		// particles then hit the shore of `field`, or nothing if nullptr.
+		// The field must outlive this object.
+		void SetShore(const Terrain::SignedDistanceField* field)
+		{
+			_shore = field;
+			RescheduleAll();
+		}
+
+		// all pending events are recomputed with the new parameters
+		void SetParameters(const SimulationParameters& parameters)
+		{
+			_parameters = parameters;
+			RescheduleAll();
+		}
+
+		void RescheduleAll()
+		{
+			_queue.Reset(_time);
+			for (uint32_t slot = 0; slot < (uint32_t)_particles.size(); slot++)
+			{
+				if (!_particles[slot].Alive) continue;
+				_particles[slot].Rebase(_time, _parameters.dampingCoefficient);
+				schedule(slot);
+			}
+		}
+
+		// adds a particle in the layout of the propagation shader (see
+		// Particle.h), as it is at time `time` >= the current time
+		void Emit(const PackedWaveParticle& packed, double time)
+		{
+			uint32_t slot = allocateSlot();
+			EventParticle& particle = _particles[slot];
+			const GLfloat angle = packed.paramVec1.z;
+			particle.Origin = glm::vec2(packed.paramVec1.x, packed.paramVec1.y);
+			particle.TimeAtOrigin = time;
+			particle.Direction = glm::vec2(std::cos(angle), std::sin(angle));
+			particle.DispersionAngle = packed.paramVec1.w;
+			particle.Velocity = std::abs(packed.paramVec2.w);
+			particle.Amplitude = packed.paramVec3.y;
+			particle.Radius = packed.paramVec3.x;
+
+			// the shader measures dispersion from the last origin
+			particle.Travelled = particle.Velocity *
+				std::max(0.0f, (GLfloat)time - packed.paramVec2.z);
+			particle.ShoreContacts = 0;
+			particle.Alive = true;
+			particle.Family = NO_PARTICLE_FAMILY;
+			particle.Branch = 0;
+			particle.Coherent = false;
+			particle.HoldSubdivision = false;
+			_numAlive++;
+			schedule(slot);
+		}
+
+		// processes all events up to `time`, in order
+		void Advance(double time)
+		{
+			_eventsProcessed = 0;
+			_queue.PopUntil(time, [this](const ParticleEvent& event) { fire(event); });
+			_time = std::max(_time, time);
+		}
+
+		// merges every family whose branches are closer than
+		// `view.MinPixelSpacing` on screen back into a single particle, and
+		// lets merged particles subdivide again once they would be twice as
+		// far apart. Returns the number of particles removed.
+		size_t UpdateLevelOfDetail(const LevelOfDetailView& view)
+		{
+			// on-screen distance of neighbouring branches of `particle`, if it
+			// were to subdivide into `branches`
+			auto pixelSpacing = [this, &view](const EventParticle& particle, GLfloat branches)
+			{
+				const glm::vec2 position = particle.PositionAt(_time);
+				const glm::vec2 side(-particle.Direction.y, particle.Direction.x);
+				const glm::vec2 offset = side * (particle.DispersionAngle / branches
+					* particle.PathLengthAt(_time));
+
+				glm::vec2 pixels[2];
+				for (int i = 0; i < 2; i++)
+				{
+					glm::vec2 world = ((position + (GLfloat)i * offset) * 0.5f + 0.5f) * view.MapSize;
+					glm::vec4 clip = view.ViewProjection * glm::vec4(world, 0.0f, 1.0f);
+					if (clip.w <= 0.0f) return 0.0f; // behind the camera
+					pixels[i] = glm::vec2(clip) / clip.w * 0.5f * view.Viewport;
+				}
+				return glm::length(pixels[1] - pixels[0]);
+			};
+
+			// coherent family members, grouped by family
+			struct Member
+			{
+				uint32_t Family;
+				int8_t Branch;
+				uint32_t Slot;
+			};
+			std::vector<Member> members;
+			const GLfloat branches = (GLfloat)_subdivisionBranches;
+			for (uint32_t slot = 0; slot < (uint32_t)_particles.size(); slot++)
+			{
+				EventParticle& particle = _particles[slot];
+				if (!particle.Alive) continue;
+
+				if (particle.HoldSubdivision &&
+					pixelSpacing(particle, branches) > 2.0f * view.MinPixelSpacing)
+				{
+					particle.HoldSubdivision = false;
+					particle.Rebase(_time, _parameters.dampingCoefficient);
+					schedule(slot);
+				}
+				if (particle.Family != NO_PARTICLE_FAMILY && particle.Coherent)
+				{
+					members.push_back({ particle.Family, particle.Branch, slot });
+				}
+			}
+			std::sort(members.begin(), members.end(), [](const Member& a, const Member& b)
+			{
+				return (a.Family != b.Family) ? a.Family < b.Family : a.Branch < b.Branch;
+			});
+
+			size_t removed = 0;
+			for (size_t begin = 0, end = 0; begin < members.size(); begin = end)
+			{
+				const uint32_t familyIndex = members[begin].Family;
+				while (end < members.size() && members[end].Family == familyIndex) end++;
+
+				// all branches must be alive, and on the same side of zero
+				const ParticleFamily family = _families[familyIndex];
+				if (end - begin != (size_t)_subdivisionBranches ||
+					family.Members != _subdivisionBranches) continue;
+
+				uint32_t centreSlot = members[begin + _subdivisionBranches / 2].Slot;
+				EventParticle& centre = _particles[centreSlot];
+				if (pixelSpacing(centre, 1.0f) >= view.MinPixelSpacing) continue;
+
+				GLfloat amplitude = 0.0f;
+				bool sameSign = true;
+				for (size_t i = begin; i < end; i++)
+				{
+					GLfloat a = _particles[members[i].Slot].AmplitudeAt(_time,
+						_parameters.dampingCoefficient);
+					sameSign = sameSign && (a < 0.0f) == (centre.Amplitude < 0.0f);
+					amplitude += a;
+				}
+				if (!sameSign) continue;
+
+				for (size_t i = begin; i < end; i++)
+				{
+					if (members[i].Slot == centreSlot) continue;
+					kill(members[i].Slot);
+					removed++;
+				}
+
+				// the centre continues as the particle before the subdivision.
+				// It rejoins the parent family before leaving its own, such that
+				// releasing this family does not release the parent as well.
+				if (family.Parent != NO_PARTICLE_FAMILY) _families[family.Parent].Members++;
+				leaveFamily(centre);
+				centre.Rebase(_time, _parameters.dampingCoefficient);
+				centre.Amplitude = amplitude;
+				centre.DispersionAngle *= branches;
+				centre.Family = family.Parent;
+				centre.Branch = family.ParentBranch;
+				centre.Coherent = family.ParentCoherent;
+				centre.HoldSubdivision = true;
+				schedule(centreSlot);
+			}
+			return removed;
+		}
+
+		// writes at most `maxCount` particles as they are at the current time,
+		// in the layout of the propagation shader. Returns the number written.
+		size_t WritePackedParticles(PackedWaveParticle* output, size_t maxCount) const
+		{
+			size_t count = 0;
+			for (const EventParticle& particle : _particles)
+			{
+				if (count == maxCount) break;
+				if (!particle.Alive) continue;
+
+				const glm::vec2 position = particle.PositionAt(_time);
+				const GLfloat amplitude = particle.AmplitudeAt(_time, _parameters.dampingCoefficient);
+				const GLfloat angle = std::atan2(particle.Direction.y, particle.Direction.x);
+
+				PackedWaveParticle& packed = output[count++];
+				packed.paramVec1 = glm::vec4(position, angle, particle.DispersionAngle);
+				packed.paramVec2 = glm::vec4(particle.Origin, (GLfloat)particle.TimeAtOrigin,
+					particle.Velocity * ((amplitude < 0.0f) ? -1.0f : 1.0f));
+				packed.paramVec3 = glm::vec4(particle.Radius, amplitude, 0.0f, 0.0f);
+			}
+			return count;
+		}
+
+		size_t GetNumParticles() const { return _numAlive; }
+
+		// events that fired during the last call to Advance
+		size_t GetEventsProcessed() const { return _eventsProcessed; }
+
+		double GetTime() const { return _time; }
+	};
+}
@@ -4,10 +4,24 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
 
 // CHECK FOR WINDOWS
 #ifndef WIN32
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
 #endif
 
 #ifdef WIN32
@@ -18,33 +32,145 @@
 namespace Core::FileIO
 {
 	// returns the extension for a target file string
-	std::string getFileExtension(const std::string& fileName)
+	inline std::string getFileExtension(const std::string& fileName)
 	{
 		return fileName.substr(fileName.find_last_of(".") + 1);
 	}
 
-	// auxillary function to read from a file
-	std::string readFileContents(const std::string& filePath)
+	// read-only view of the contents of a file, which is memory-mapped when
+	// possible, such that large files are not copied before being used.
+	// If mapping fails, the whole file is read into memory instead.
+	//
+	// The contents stay valid for the lifetime of the view.
+	class FileView
 	{
-		std::string contents;
-		std::ifstream fileStream(filePath, std::ios::in);
+	private:
+		const char* _data = nullptr;
+		size_t _size = 0;
+		bool _isOpen = false;
+		bool _isMapped = false;
+		std::vector<char> _contents; // when not mapped
 
-		if (!fileStream.is_open())
+#ifdef WIN32
+		HANDLE _file = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = NULL;
+#endif
+
+		bool Map(const std::string& filePath)
 		{
-			std::cerr << "Could not read file '"
-				<< filePath << "'." << std::endl;
-			return "";
+#ifdef WIN32
+			_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (_file == INVALID_HANDLE_VALUE) return false;
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(_file, &size)) return false;
+			_isOpen = true;
+			_size = (size_t)size.QuadPart;
+			if (_size == 0) return true; // empty files cannot be mapped
+
+			_mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (_mapping == NULL) return false;
+			_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+			int fd = open(filePath.c_str(), O_RDONLY);
+			if (fd < 0) return false;
+
+			struct stat info;
+			if (fstat(fd, &info) != 0)
+			{
+				close(fd);
+				return false;
+			}
+			_isOpen = true;
+			_size = (size_t)info.st_size;
+			if (_size == 0)
+			{
+				close(fd);
+				return true; // empty files cannot be mapped
+			}
+
+			void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd); // the mapping keeps the file open
+			if (data == MAP_FAILED) return false;
+			_data = (const char*)data;
+#endif
+			_isMapped = (_data != nullptr);
+			return _isMapped;
 		}
 
-		std::string line = "";
-		while (!fileStream.eof())
+		void Unmap()
 		{
-			std::getline(fileStream, line);
-			contents.append(line + "\n");
+#ifdef WIN32
+			if (_isMapped) UnmapViewOfFile(_data);
+			if (_mapping != NULL) CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+			_mapping = NULL;
+			_file = INVALID_HANDLE_VALUE;
+#else
+			if (_isMapped) munmap((void*)_data, _size);
+#endif
+			_isMapped = false;
+			_data = nullptr;
 		}
 
-		fileStream.close();
-		return contents;
+		// fallback, e.g. for files on file systems that do not support mapping
+		bool ReadAll(const std::string& filePath)
+		{
+			std::ifstream fileStream(filePath, std::ios::in | std::ios::binary | std::ios::ate);
+			if (!fileStream.is_open()) return false;
+
+			_size = (size_t)fileStream.tellg();
+			_contents.resize(_size);
+			fileStream.seekg(0);
+			fileStream.read(_contents.data(), _size);
+			_data = _contents.data();
+			_isOpen = (bool)fileStream;
+			return _isOpen;
+		}
+
+	public:
+		explicit FileView(const std::string& filePath)
+		{
+			if (!Map(filePath))
+			{
+				Unmap();
+				_isOpen = false;
+				_size = 0;
+				ReadAll(filePath);
+			}
+		}
+
+		FileView(const FileView&) = delete;
+		FileView& operator= (const FileView&) = delete;
+
+		~FileView()
+		{
+			Unmap();
+		}
+
+		bool IsOpen() const { return _isOpen; }
+		bool IsMapped() const { return _isMapped; }
+		const char* GetData() const { return _data; }
+		size_t GetSize() const { return _size; }
+
+		std::string_view GetContents() const
+		{
+			return std::string_view(_data, _size);
+		}
+	};
+
+	// auxillary function to read from a file
+	inline std::string readFileContents(const std::string& filePath)
+	{
+		FileView file(filePath);
+		if (!file.IsOpen())
+		{
+			std::cerr << "Could not read file '"
+				<< filePath << "'." << std::endl;
+			return "";
+		}
+		return std::string(file.GetContents());
 	}
 
 	// intended functionality to retrieve platform-dependent
@@ -62,7 +188,7 @@ namespace Core::FileIO
 
 	// creating a platform-dependent string path from the
 	// specified target file
-	std::string getPlatformFilePath(const char* file)
+	inline std::string getPlatformFilePath(const char* file)
 	{
 		char sep = getPlatformSeparator();
 
@@ -85,7 +211,7 @@ namespace Core::FileIO
 
 	// almost same as above, e.g. usage:
 	// getPlatformPath("path1/path2/path3") -> "path1/path2/path3/"
-	std::string getPlatformPath(const char* path)
+	inline std::string getPlatformPath(const char* path)
 	{
 		// TODO: Check if last char is already path-separator before concatenating!
 		return getPlatformFilePath(path) + getPlatformSeparator();
@@ -0,0 +1,44 @@
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+namespace Utilities::Hash
+{
+	// FNV-1a, see http://www.isthe.com/chongo/tech/comp/fnv/
+	static constexpr uint32_t FNV1A_32_OFFSET = 2166136261u;
+	static constexpr uint32_t FNV1A_32_PRIME = 16777619u;
+	static constexpr uint64_t FNV1A_64_OFFSET = 14695981039346656037ull;
+	static constexpr uint64_t FNV1A_64_PRIME = 1099511628211ull;
+
+	// 32-bit hash of a null-terminated string, usable at compile time
+	constexpr uint32_t Fnv1a32(const char* str, uint32_t hash = FNV1A_32_OFFSET)
+	{
+		while (*str != '\0')
+		{
+			hash = (hash ^ (uint8_t)*str++) * FNV1A_32_PRIME;
+		}
+		return hash;
+	}
+
+	// 64-bit hash of `size` bytes, continuing from `hash`, such that
+	// several buffers can be combined into one key
+	inline uint64_t Fnv1a64(const void* data, size_t size, uint64_t hash = FNV1A_64_OFFSET)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * FNV1A_64_PRIME;
+		}
+		return hash;
+	}
+
+	inline uint64_t Fnv1a64(const std::string& str, uint64_t hash = FNV1A_64_OFFSET)
+	{
+		// include the terminator, so "ab" + "c" differs from "a" + "bc"
+		return Fnv1a64(str.c_str(), str.size() + 1, hash);
+	}
+}
@@ -0,0 +1,242 @@
+///
+/// Height Evaluator
+///
+/// Water heights computed on the CPU directly from the particles, at full
+/// precision rather than at the resolution of the distribution texture.
+/// Each particle contributes the cosine blending kernel of particleBlending,
+///
+///     h(d) = A / 2 * (cos(pi * d / r) + 1),   d < r
+///
+/// which is found through a uniform grid of cells at least as wide as the
+/// largest particle radius, such that only the 3x3 cells around a query
+/// point need to be visited. The grid is rebuilt from the particles with a
+/// counting sort, and stores them sorted by cell, as separate arrays per
+/// attribute. The three cells of a grid row are then one contiguous range,
+/// which is summed four particles at a time with SSE where available.
+///
+/// Batches of queries are split across worker threads.
+///
+
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEIGHT_EVALUATOR_SSE
+#include <emmintrin.h>
+#endif
+
+// CUSTOM
+#include "OpenGL.h"
+#include "Particle.h"
+#include "ParallelFor.h"
+
+
+namespace Simulation
+{
+	class HeightEvaluator
+	{
+	private:
+		// cells along the longer side of the particle bounds, at most
+		static constexpr int MAX_GRID_SIZE = 256;
+
+		// queries per thread, below which a batch is not split further
+		static constexpr size_t MIN_QUERIES_PER_THREAD = 256;
+
+		glm::vec2 _origin = glm::vec2(0.0f);
+		GLfloat _cellSize = 1.0f;
+		GLfloat _inverseCellSize = 1.0f;
+		int _width = 0, _height = 0;
+
+		// per cell, the first particle of the cell in the arrays below,
+		// followed by one past the last cell
+		std::vector<uint32_t> _cellStart;
+
+		// particles sorted by cell
+		std::vector<GLfloat> _x, _y;
+		std::vector<GLfloat> _radii;
+		std::vector<GLfloat> _inverseRadii;
+		std::vector<GLfloat> _amplitudes;
+
+		// scratch space of Rebuild
+		std::vector<uint32_t> _cells;
+		std::vector<uint32_t> _next;
+
+		int getCellX(GLfloat x) const
+		{
+			return std::clamp((int)((x - _origin.x) * _inverseCellSize), 0, _width - 1);
+		}
+		int getCellY(GLfloat y) const
+		{
+			return std::clamp((int)((y - _origin.y) * _inverseCellSize), 0, _height - 1);
+		}
+
+		// (cos(pi * t) + 1) / 2 for t in [0, 1], as cos(pi * t) = -sin(s) with
+		// s = pi * (t - 1/2) in [-pi/2, pi/2], and a Taylor polynomial of sin
+		// good to about 1e-6. The SSE path evaluates the very same polynomial.
+		static GLfloat kernel(GLfloat t)
+		{
+			const GLfloat s = glm::pi<GLfloat>() * (t - 0.5f);
+			const GLfloat s2 = s * s;
+			GLfloat sine = 1.0f / 362880.0f;
+			sine = sine * s2 - 1.0f / 5040.0f;
+			sine = sine * s2 + 1.0f / 120.0f;
+			sine = sine * s2 - 1.0f / 6.0f;
+			sine = sine * s2 + 1.0f;
+			return 0.5f - 0.5f * sine * s;
+		}
+
+		// sum over the particles [begin, end) at (x, y)
+		GLfloat sumRange(GLfloat x, GLfloat y, uint32_t begin, uint32_t end) const
+		{
+			GLfloat height = 0.0f;
+			uint32_t i = begin;
+#ifdef HEIGHT_EVALUATOR_SSE
+			const __m128 px = _mm_set1_ps(x);
+			const __m128 py = _mm_set1_ps(y);
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 pi = _mm_set1_ps(glm::pi<GLfloat>());
+			__m128 sum = _mm_setzero_ps();
+			for (; i + 4 <= end; i += 4)
+			{
+				const __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&_x[i]));
+				const __m128 dy = _mm_sub_ps(py, _mm_loadu_ps(&_y[i]));
+				const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+				const __m128 inside = _mm_cmplt_ps(distance, _mm_loadu_ps(&_radii[i]));
+				if (_mm_movemask_ps(inside) == 0) continue;
+
+				const __m128 t = _mm_mul_ps(distance, _mm_loadu_ps(&_inverseRadii[i]));
+				const __m128 s = _mm_mul_ps(pi, _mm_sub_ps(t, half));
+				const __m128 s2 = _mm_mul_ps(s, s);
+				__m128 sine = _mm_set1_ps(1.0f / 362880.0f);
+				sine = _mm_sub_ps(_mm_mul_ps(sine, s2), _mm_set1_ps(1.0f / 5040.0f));
+				sine = _mm_add_ps(_mm_mul_ps(sine, s2), _mm_set1_ps(1.0f / 120.0f));
+				sine = _mm_sub_ps(_mm_mul_ps(sine, s2), _mm_set1_ps(1.0f / 6.0f));
+				sine = _mm_add_ps(_mm_mul_ps(sine, s2), _mm_set1_ps(1.0f));
+				const __m128 k = _mm_sub_ps(half, _mm_mul_ps(half, _mm_mul_ps(sine, s)));
+
+				const __m128 contribution = _mm_mul_ps(_mm_loadu_ps(&_amplitudes[i]), k);
+				sum = _mm_add_ps(sum, _mm_and_ps(inside, contribution));
+			}
+			alignas(16) GLfloat lanes[4];
+			_mm_store_ps(lanes, sum);
+			height = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+			for (; i < end; i++)
+			{
+				const GLfloat dx = x - _x[i];
+				const GLfloat dy = y - _y[i];
+				const GLfloat distance = std::sqrt(dx * dx + dy * dy);
+				if (distance < _radii[i])
+				{
+					height += _amplitudes[i] * kernel(distance * _inverseRadii[i]);
+				}
+			}
+			return height;
+		}
+
+	public:
+		// indexes the first `count` of `particles`, usually once per tick
+		void Rebuild(const PackedWaveParticle* particles, size_t count)
+		{
+			if (count == 0)
+			{
+				_width = _height = 0;
+				_cellStart.assign(1, 0);
+				_x.clear();
+				_y.clear();
+				_radii.clear();
+				_inverseRadii.clear();
+				_amplitudes.clear();
+				return;
+			}
+
+			glm::vec2 lower(particles[0].paramVec1.x, particles[0].paramVec1.y);
+			glm::vec2 upper = lower;
+			GLfloat maxRadius = 0.0f;
+			for (size_t i = 0; i < count; i++)
+			{
+				glm::vec2 position(particles[i].paramVec1.x, particles[i].paramVec1.y);
+				lower = glm::min(lower, position);
+				upper = glm::max(upper, position);
+				maxRadius = std::max(maxRadius, particles[i].paramVec3.x);
+			}
+
+			const glm::vec2 extent = upper - lower;
+			_cellSize = std::max({ maxRadius, std::max(extent.x, extent.y) / MAX_GRID_SIZE, 1e-6f });
+			_inverseCellSize = 1.0f / _cellSize;
+			_origin = lower;
+			_width = std::min((int)(extent.x * _inverseCellSize) + 1, MAX_GRID_SIZE);
+			_height = std::min((int)(extent.y * _inverseCellSize) + 1, MAX_GRID_SIZE);
+
+			// counting sort by cell
+			_cells.resize(count);
+			_cellStart.assign((size_t)_width * _height + 1, 0);
+			for (size_t i = 0; i < count; i++)
+			{
+				const glm::vec4& p = particles[i].paramVec1;
+				_cells[i] = (uint32_t)(getCellY(p.y) * _width + getCellX(p.x));
+				_cellStart[_cells[i] + 1]++;
+			}
+			for (size_t c = 1; c < _cellStart.size(); c++)
+			{
+				_cellStart[c] += _cellStart[c - 1];
+			}
+
+			_x.resize(count);
+			_y.resize(count);
+			_radii.resize(count);
+			_inverseRadii.resize(count);
+			_amplitudes.resize(count);
+			_next.assign(_cellStart.begin(), _cellStart.end() - 1);
+			for (size_t i = 0; i < count; i++)
+			{
+				const uint32_t j = _next[_cells[i]]++;
+				const GLfloat radius = particles[i].paramVec3.x;
+				_x[j] = particles[i].paramVec1.x;
+				_y[j] = particles[i].paramVec1.y;
+				_radii[j] = radius;
+				_inverseRadii[j] = (radius > 0.0f) ? 1.0f / radius : 0.0f;
+				_amplitudes[j] = particles[i].paramVec3.y;
+			}
+		}
+
+		size_t GetNumParticles() const { return _x.size(); }
+
+		// the height at `position`, in the simulation domain
+		GLfloat GetHeight(glm::vec2 position) const
+		{
+			if (_x.empty()) return 0.0f;
+
+			const int cx = getCellX(position.x);
+			const int cy = getCellY(position.y);
+			const int x0 = std::max(cx - 1, 0);
+			const int x1 = std::min(cx + 1, _width - 1);
+			GLfloat height = 0.0f;
+			for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, _height - 1); y++)
+			{
+				height += sumRange(position.x, position.y,
+					_cellStart[y * _width + x0], _cellStart[y * _width + x1 + 1]);
+			}
+			return height;
+		}
+
+		// heights at `count` positions, on up to `numThreads` threads
+		void GetHeights(const glm::vec2* positions, GLfloat* heights, size_t count,
+			unsigned int numThreads = Utilities::GetNumWorkerThreads()) const
+		{
+			numThreads = (unsigned int)std::min<size_t>(numThreads,
+				(count + MIN_QUERIES_PER_THREAD - 1) / MIN_QUERIES_PER_THREAD);
+			Utilities::ParallelFor(count, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+				{
+					heights[i] = GetHeight(positions[i]);
+				}
+			}, numThreads);
+		}
+	};
+}
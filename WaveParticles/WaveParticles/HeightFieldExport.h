@@ -0,0 +1,398 @@
+///
+/// Height Field Export
+///
+/// Streams the wave particle distribution texture (the deviation of the
+/// water surface, xy horizontal and z vertical) to disk, for offline tools
+/// such as buoyancy simulations.
+///
+/// Each exported frame is read back into one of two pixel buffer objects,
+/// converted to float16 by the driver, and only mapped once its fence has
+/// signalled, a frame or more later. The mapped frame is handed to a
+/// background thread, which encodes and writes it. Neither step waits: a
+/// frame is dropped instead if both buffers are still in flight, or if
+/// the writer has fallen too far behind.
+///
+/// File layout:
+///   - HeightFieldFileHeader
+///   - chunks of up to FramesPerChunk frames:
+///       - HeightFieldChunkHeader
+///       - per frame, HeightFieldFrameHeader and EncodedWords uint16 words
+///
+/// A frame is encoded as the XOR of its float16 values with the previous
+/// frame of the same chunk (zero for the first frame of a chunk, so every
+/// chunk decodes on its own). The XOR is run-length encoded as tokens of
+/// (zero run, literal count, literals), which compresses well because most
+/// of the water is calm, or changes little between frames.
+/// See DecodeHeightFieldFrame.
+///
+
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// CUSTOM
+#include "OpenGL.h"
+
+
+namespace Simulation
+{
+	static constexpr uint32_t HEIGHT_FIELD_MAGIC = 0x46485057;       // "WPHF"
+	static constexpr uint32_t HEIGHT_FIELD_CHUNK_MAGIC = 0x43485057; // "WPHC"
+	static constexpr uint32_t HEIGHT_FIELD_VERSION = 1;
+
+	struct HeightFieldFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Channels;       // float16 values per texel
+		uint32_t FramesPerChunk;
+		uint32_t NumFrames;
+		uint32_t NumChunks;
+	};
+
+	struct HeightFieldChunkHeader
+	{
+		uint32_t Magic;
+		uint32_t NumFrames;
+		uint64_t ByteSize;       // of the frames following this header
+	};
+
+	struct HeightFieldFrameHeader
+	{
+		uint64_t Tick;           // simulation clock
+		double Time;
+		uint32_t EncodedWords;
+		uint32_t _padding;
+	};
+
+	// appends the encoding of `frame` against `previous` to `output`
+	inline void EncodeHeightFieldFrame(const uint16_t* frame, const uint16_t* previous,
+		size_t count, std::vector<uint16_t>& output)
+	{
+		size_t i = 0;
+		while (i < count)
+		{
+			size_t zeros = 0;
+			while (i < count && zeros < 0xFFFF && (frame[i] ^ previous[i]) == 0)
+			{
+				zeros++;
+				i++;
+			}
+			size_t literals = 0;
+			while (i + literals < count && literals < 0xFFFF &&
+				(frame[i + literals] ^ previous[i + literals]) != 0)
+			{
+				literals++;
+			}
+			output.push_back((uint16_t)zeros);
+			output.push_back((uint16_t)literals);
+			for (size_t j = 0; j < literals; j++, i++)
+			{
+				output.push_back(frame[i] ^ previous[i]);
+			}
+		}
+	}
+
+	// decodes `numWords` words into `frame`, which holds the previous frame
+	// of the chunk (or zeros) before the call. Returns false on corrupt input.
+	inline bool DecodeHeightFieldFrame(const uint16_t* words, size_t numWords,
+		uint16_t* frame, size_t count)
+	{
+		size_t i = 0;
+		size_t w = 0;
+		while (w + 2 <= numWords)
+		{
+			size_t zeros = words[w++];
+			size_t literals = words[w++];
+			if (i + zeros + literals > count || w + literals > numWords) return false;
+			i += zeros;
+			for (size_t j = 0; j < literals; j++)
+			{
+				frame[i++] ^= words[w++];
+			}
+		}
+		return i == count && w == numWords;
+	}
+
+	// encodes and writes frames on a background thread
+	class HeightFieldWriter
+	{
+	private:
+		struct Frame
+		{
+			uint64_t Tick;
+			double Time;
+			std::vector<uint16_t> Values;
+		};
+
+		std::ofstream _file;
+		HeightFieldFileHeader _header;
+		size_t _count; // values per frame
+
+		// frames waiting to be written, at most _maxQueued
+		std::deque<Frame> _queue;
+		std::vector<std::vector<uint16_t>> _freeValues; // recycled allocations
+		size_t _maxQueued;
+		bool _stopping = false;
+		std::mutex _mutex;
+		std::condition_variable _wakeUp;
+		std::thread _thread;
+
+		// writer thread only
+		std::vector<uint16_t> _previous;
+		std::vector<char> _chunk;
+		uint32_t _chunkFrames = 0;
+
+		void flushChunk()
+		{
+			if (_chunkFrames == 0) return;
+			HeightFieldChunkHeader chunkHeader = { HEIGHT_FIELD_CHUNK_MAGIC, _chunkFrames,
+				(uint64_t)_chunk.size() };
+			_file.write((const char*)&chunkHeader, sizeof(chunkHeader));
+			_file.write(_chunk.data(), _chunk.size());
+			_header.NumChunks++;
+			_chunk.clear();
+			_chunkFrames = 0;
+		}
+
+		void writeFrame(const Frame& frame, std::vector<uint16_t>& encoded)
+		{
+			if (_chunkFrames == 0)
+			{
+				std::fill(_previous.begin(), _previous.end(), (uint16_t)0);
+			}
+
+			encoded.clear();
+			EncodeHeightFieldFrame(frame.Values.data(), _previous.data(), _count, encoded);
+			_previous = frame.Values;
+
+			HeightFieldFrameHeader frameHeader = { frame.Tick, frame.Time,
+				(uint32_t)encoded.size(), 0 };
+			const char* headerBytes = (const char*)&frameHeader;
+			const char* wordBytes = (const char*)encoded.data();
+			_chunk.insert(_chunk.end(), headerBytes, headerBytes + sizeof(frameHeader));
+			_chunk.insert(_chunk.end(), wordBytes, wordBytes + encoded.size() * sizeof(uint16_t));
+			_header.NumFrames++;
+
+			if (++_chunkFrames == _header.FramesPerChunk) flushChunk();
+		}
+
+		void run()
+		{
+			std::vector<uint16_t> encoded;
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (true)
+			{
+				_wakeUp.wait(lock, [this] { return _stopping || !_queue.empty(); });
+				if (_queue.empty()) break; // stopping, and everything is written
+
+				Frame frame = std::move(_queue.front());
+				_queue.pop_front();
+				lock.unlock();
+
+				writeFrame(frame, encoded);
+
+				lock.lock();
+				_freeValues.push_back(std::move(frame.Values));
+			}
+		}
+
+	public:
+		HeightFieldWriter(const std::string& filePath, uint32_t width, uint32_t height,
+			uint32_t channels, uint32_t framesPerChunk = 64, size_t maxQueued = 8)
+			: _file(filePath, std::ios::out | std::ios::binary | std::ios::trunc),
+			_count((size_t)width * height * channels), _maxQueued(maxQueued),
+			_previous(_count, 0)
+		{
+			if (!_file.is_open())
+			{
+				std::cerr << "Could not write height field '" << filePath << "'." << std::endl;
+			}
+			_header = { HEIGHT_FIELD_MAGIC, HEIGHT_FIELD_VERSION, width, height, channels,
+				std::max(framesPerChunk, 1u), 0, 0 };
+			_file.write((const char*)&_header, sizeof(_header));
+			_thread = std::thread(&HeightFieldWriter::run, this);
+		}
+
+		// writes the remaining frames, and completes the header
+		~HeightFieldWriter()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_wakeUp.notify_one();
+			_thread.join();
+
+			flushChunk();
+			_file.seekp(0);
+			_file.write((const char*)&_header, sizeof(_header));
+		}
+
+		HeightFieldWriter(const HeightFieldWriter&) = delete;
+		HeightFieldWriter& operator= (const HeightFieldWriter&) = delete;
+
+		size_t GetValuesPerFrame() const { return _count; }
+
+		// copies `values` (GetValuesPerFrame float16 values) into the queue.
+		// Returns false, and drops the frame, if the queue is full.
+		bool Push(uint64_t tick, double time, const uint16_t* values)
+		{
+			std::vector<uint16_t> copy;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (_queue.size() >= _maxQueued) return false;
+				if (!_freeValues.empty())
+				{
+					copy = std::move(_freeValues.back());
+					_freeValues.pop_back();
+				}
+			}
+			copy.assign(values, values + _count);
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_queue.push_back({ tick, time, std::move(copy) });
+			}
+			_wakeUp.notify_one();
+			return true;
+		}
+	};
+
+	// reads frames of a float RGB color attachment back into a
+	// HeightFieldWriter, without waiting for the GPU
+	class HeightFieldExporter
+	{
+	private:
+		struct Readback
+		{
+			GLuint Buffer = 0;
+			GLsync Fence = nullptr;
+			uint64_t Tick = 0;
+			double Time = 0.0;
+		};
+
+		static constexpr int NUM_READBACKS = 2;
+		static constexpr uint32_t CHANNELS = 3;
+
+		HeightFieldWriter _writer;
+		GLsizei _width, _height;
+		Readback _readbacks[NUM_READBACKS];
+		int _next = 0;     // readback the next frame goes into
+		int _oldest = 0;   // readback completing first
+		size_t _numExported = 0;
+		size_t _numDropped = 0;
+
+		GLsizeiptr getByteSize() const
+		{
+			return (GLsizeiptr)_writer.GetValuesPerFrame() * sizeof(uint16_t);
+		}
+
+	public:
+		HeightFieldExporter(const std::string& filePath, GLsizei width, GLsizei height)
+			: _writer(filePath, (uint32_t)width, (uint32_t)height, CHANNELS),
+			_width(width), _height(height)
+		{
+			for (Readback& readback : _readbacks)
+			{
+				glGenBuffers(1, &readback.Buffer);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+				glBufferData(GL_PIXEL_PACK_BUFFER, getByteSize(), nullptr, GL_STREAM_READ);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		~HeightFieldExporter()
+		{
+			Poll(true);
+			for (Readback& readback : _readbacks)
+			{
+				if (readback.Fence != nullptr) glDeleteSync(readback.Fence);
+				glDeleteBuffers(1, &readback.Buffer);
+			}
+			printf("Height field export: %zu frames written, %zu dropped\n",
+				_numExported, _numDropped);
+		}
+
+		HeightFieldExporter(const HeightFieldExporter&) = delete;
+		HeightFieldExporter& operator= (const HeightFieldExporter&) = delete;
+
+		// starts the readback of the color attachment 0 of `framebuffer`
+		void Capture(GLuint framebuffer, uint64_t tick, double time)
+		{
+			Readback& readback = _readbacks[_next];
+			if (readback.Fence != nullptr)
+			{
+				_numDropped++;
+				return;
+			}
+
+			// only the read binding changes, and is restored afterwards, such
+			// that whatever the host is drawing into stays bound
+			GLint previousFramebuffer = 0;
+			GLint previousAlignment = 4;
+			glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+			glGetIntegerv(GL_PACK_ALIGNMENT, &previousAlignment);
+
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+			glReadBuffer(GL_COLOR_ATTACHMENT0);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+			glReadPixels(0, 0, _width, _height, GL_RGB, GL_HALF_FLOAT, nullptr);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			glPixelStorei(GL_PACK_ALIGNMENT, previousAlignment);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+			readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			readback.Tick = tick;
+			readback.Time = time;
+			_next = (_next + 1) % NUM_READBACKS;
+		}
+
+		// hands every completed readback to the writer, in order, or, with
+		// `wait`, all pending ones. Call once per frame.
+		void Poll(bool wait = false)
+		{
+			for (int i = 0; i < NUM_READBACKS; i++)
+			{
+				Readback& readback = _readbacks[_oldest];
+				if (readback.Fence == nullptr) return;
+
+				const GLuint64 timeout = wait ? 1000000000ull : 0; // nanoseconds
+				GLenum status = glClientWaitSync(readback.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+				if (status == GL_TIMEOUT_EXPIRED) return;
+				glDeleteSync(readback.Fence);
+				readback.Fence = nullptr;
+				_oldest = (_oldest + 1) % NUM_READBACKS;
+
+				bool written = false;
+				if (status != GL_WAIT_FAILED)
+				{
+					glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+					const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+						getByteSize(), GL_MAP_READ_BIT);
+					if (data != nullptr)
+					{
+						written = _writer.Push(readback.Tick, readback.Time,
+							(const uint16_t*)data);
+					}
+					glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+					glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+				}
+				if (written) _numExported++;
+				else _numDropped++;
+			}
+		}
+	};
+}
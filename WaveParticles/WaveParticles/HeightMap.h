@@ -5,6 +5,8 @@
 
 // STANDARD
 #include <cassert>
+#include <cstdint>
+#include <vector>
 
 
 namespace Terrain
@@ -13,31 +15,43 @@ namespace Terrain
 		HEIGHT_FIELD_TYPE_OCEAN,
 		HEIGHT_FIELD_TYPE_SHALLOW_WATER,
 		HEIGHT_FIELD_TYPE_LAND,
-		// create more?
+		// create more? (at most 4 types fit in the packed type plane)
 	} HeightMapFieldType;
 
+	// a single field, as returned by HeightMap::operator()
 	class HeightMapField
 	{
 	public:
 		GLfloat Height;
 		HeightMapFieldType Type;
 	};
-	
+
+	// square height map, stored as two separate planes:
+	//   - heights, one float per field
+	//   - field types, 2 bits per field (four fields per byte)
+	// Both are row-major (index y * size + x), such that iterating rows,
+	// e.g. to build a mesh, reads memory linearly.
 	class HeightMap
 	{
 	private:
-		HeightMapField* _heightMap;
+		std::vector<GLfloat> _heights;
+		std::vector<uint8_t> _types;
 		unsigned int _size;
 
-	public:
-		HeightMap(unsigned int size)
+		inline size_t GetIndex(unsigned int x, unsigned int y) const
 		{
-			_heightMap = new HeightMapField[size * size];
-			_size = size;
+			assert(x < _size);
+			assert(y < _size);
+			return (size_t)y * _size + x;
 		}
-		~HeightMap()
+
+	public:
+		// every field starts as ocean at height 0
+		HeightMap(unsigned int size)
+			: _heights((size_t)size * size, 0.0f),
+			_types(((size_t)size * size + 3) / 4, 0),
+			_size(size)
 		{
-			delete _heightMap;
 		}
 
 		int GetSize() const
@@ -45,23 +59,45 @@ namespace Terrain
 			return _size;
 		}
 
-		const HeightMapField* GetHeightMap() const
+		// the height plane, row-major
+		const GLfloat* GetHeights() const
 		{
-			return _heightMap;
+			return _heights.data();
 		}
 
-		HeightMapField& operator() (unsigned int x, unsigned int y)
+		// the type plane, 2 bits per field, lowest bits first
+		const uint8_t* GetTypes() const
 		{
-			assert(x < _size);
-			assert(y < _size);
-			return _heightMap[x * _size + y];
+			return _types.data();
 		}
 
-		const HeightMapField& operator() (unsigned int x, unsigned int y) const
+		GLfloat GetHeight(unsigned int x, unsigned int y) const
 		{
-			assert(x < _size);
-			assert(y < _size);
-			return _heightMap[x * _size + y];
+			return _heights[GetIndex(x, y)];
+		}
+
+		void SetHeight(unsigned int x, unsigned int y, GLfloat height)
+		{
+			_heights[GetIndex(x, y)] = height;
+		}
+
+		HeightMapFieldType GetType(unsigned int x, unsigned int y) const
+		{
+			size_t index = GetIndex(x, y);
+			return (HeightMapFieldType)((_types[index >> 2] >> ((index & 3) * 2)) & 0x3);
+		}
+
+		void SetType(unsigned int x, unsigned int y, HeightMapFieldType type)
+		{
+			size_t index = GetIndex(x, y);
+			uint8_t& packed = _types[index >> 2];
+			int shift = (int)(index & 3) * 2;
+			packed = (uint8_t)((packed & ~(0x3 << shift)) | ((type & 0x3) << shift));
+		}
+
+		HeightMapField operator() (unsigned int x, unsigned int y) const
+		{
+			return { GetHeight(x, y), GetType(x, y) };
 		}
 	};
-}
\ No newline at end of file
+}
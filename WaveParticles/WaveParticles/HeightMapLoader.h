@@ -0,0 +1,181 @@
+///
+/// Height Map Loader
+///
+/// Loads 16-bit height maps into a Terrain::HeightMap:
+///   - RAW: headerless, square, unsigned 16-bit samples (little-endian by
+///     default, as exported by most terrain tools)
+///   - PGM: binary "P5" greymap with maxval > 255, i.e. 16-bit big-endian
+///     samples, which most image tools can convert a 16-bit PNG to
+///
+/// Samples are mapped linearly from [0, maxval] to [minHeight, maxHeight].
+/// Field types are then assigned with ClassifyHeights.
+///
+/// Maps too large for memory should be converted to the tiled format
+/// instead, see TiledHeightMap.h.
+///
+
+#pragma once
+
+// STANDARD
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <string>
+
+// CUSTOM
+#include "HeightMap.h"
+#include "FileIO.h"
+
+
+namespace Terrain
+{
+	// type of a single field, given its height. Fields at or above sea level
+	// are land, fields less than `shallowDepth` below it are shallow water.
+	inline HeightMapFieldType ClassifyHeight(GLfloat height, GLfloat seaLevel,
+		GLfloat shallowDepth)
+	{
+		if (height >= seaLevel) return HEIGHT_FIELD_TYPE_LAND;
+		if (height >= seaLevel - shallowDepth) return HEIGHT_FIELD_TYPE_SHALLOW_WATER;
+		return HEIGHT_FIELD_TYPE_OCEAN;
+	}
+
+	// assign the type of every field from its height
+	inline void ClassifyHeights(HeightMap& heightMap, GLfloat seaLevel, GLfloat shallowDepth)
+	{
+		const unsigned int size = heightMap.GetSize();
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				heightMap.SetType(x, y,
+					ClassifyHeight(heightMap.GetHeight(x, y), seaLevel, shallowDepth));
+			}
+		}
+	}
+
+	// reads the 16-bit sample at `index` from `data`
+	inline uint16_t readSample16(const unsigned char* data, size_t index, bool bigEndian)
+	{
+		const unsigned char* sample = data + 2 * index;
+		return bigEndian ? (uint16_t)((sample[0] << 8) | sample[1])
+			: (uint16_t)((sample[1] << 8) | sample[0]);
+	}
+
+	// fills a new height map of `size` x `size` from row-major 16-bit samples
+	inline HeightMap* createHeightMap(const unsigned char* samples, unsigned int size,
+		bool bigEndian, unsigned int maxValue, GLfloat minHeight, GLfloat maxHeight)
+	{
+		HeightMap* heightMap = new HeightMap(size);
+		const GLfloat scale = (maxHeight - minHeight) / (GLfloat)maxValue;
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				uint16_t sample = readSample16(samples, (size_t)y * size + x, bigEndian);
+				heightMap->SetHeight(x, y, minHeight + scale * sample);
+			}
+		}
+		return heightMap;
+	}
+
+	// loads a square RAW height map. The side length is derived from the file size.
+	// Returns nullptr if the file cannot be read or is not square.
+	inline HeightMap* LoadRawHeightMap(const std::string& filePath, GLfloat minHeight,
+		GLfloat maxHeight, bool bigEndian = false)
+	{
+		Core::FileIO::FileView file(filePath);
+		if (!file.IsOpen())
+		{
+			std::cerr << "Could not read height map '" << filePath << "'." << std::endl;
+			return nullptr;
+		}
+
+		const size_t numSamples = file.GetSize() / 2;
+		const unsigned int size = (unsigned int)std::lround(std::sqrt((double)numSamples));
+		if (size == 0 || (size_t)size * size * 2 != file.GetSize())
+		{
+			fprintf(stderr, "---> ERROR: RAW height map '%s' is not a square of "
+				"16-bit samples!\n", filePath.c_str());
+			return nullptr;
+		}
+
+		return createHeightMap((const unsigned char*)file.GetData(), size, bigEndian,
+			0xFFFF, minHeight, maxHeight);
+	}
+
+	// loads a square, binary 16-bit PGM height map.
+	// Returns nullptr if the file cannot be read or is not supported.
+	inline HeightMap* LoadPgmHeightMap(const std::string& filePath, GLfloat minHeight,
+		GLfloat maxHeight)
+	{
+		Core::FileIO::FileView file(filePath);
+		if (!file.IsOpen())
+		{
+			std::cerr << "Could not read height map '" << filePath << "'." << std::endl;
+			return nullptr;
+		}
+
+		// header: "P5" width height maxval, separated by whitespace, where
+		// comments run from '#' to the end of the line
+		const char* data = file.GetData();
+		const size_t fileSize = file.GetSize();
+		size_t pos = 2;
+		unsigned int values[3] = { 0, 0, 0 };
+		bool valid = fileSize > 2 && data[0] == 'P' && data[1] == '5';
+		for (int i = 0; i < 3 && valid; i++)
+		{
+			while (pos < fileSize && (isspace((unsigned char)data[pos]) || data[pos] == '#'))
+			{
+				if (data[pos] == '#')
+				{
+					while (pos < fileSize && data[pos] != '\n') pos++;
+				}
+				else pos++;
+			}
+			valid = pos < fileSize && isdigit((unsigned char)data[pos]);
+			while (pos < fileSize && isdigit((unsigned char)data[pos]))
+			{
+				values[i] = values[i] * 10 + (data[pos++] - '0');
+			}
+		}
+		pos++; // single whitespace before the samples
+
+		const unsigned int width = values[0];
+		const unsigned int height = values[1];
+		const unsigned int maxValue = values[2];
+		if (!valid || maxValue < 256 || maxValue > 0xFFFF)
+		{
+			fprintf(stderr, "---> ERROR: '%s' is not a binary 16-bit PGM file!\n",
+				filePath.c_str());
+			return nullptr;
+		}
+		if (width != height || width == 0 || pos + (size_t)width * height * 2 > fileSize)
+		{
+			fprintf(stderr, "---> ERROR: PGM height map '%s' must be square and complete!\n",
+				filePath.c_str());
+			return nullptr;
+		}
+
+		return createHeightMap((const unsigned char*)data + pos, width, true,
+			maxValue, minHeight, maxHeight);
+	}
+
+	// picks the loader from the file extension (.raw, .r16, or .pgm)
+	inline HeightMap* LoadHeightMap(const std::string& filePath, GLfloat minHeight,
+		GLfloat maxHeight)
+	{
+		const std::string extension = Core::FileIO::getFileExtension(filePath);
+		if (extension == "pgm")
+		{
+			return LoadPgmHeightMap(filePath, minHeight, maxHeight);
+		}
+		if (extension == "raw" || extension == "r16")
+		{
+			return LoadRawHeightMap(filePath, minHeight, maxHeight);
+		}
+		fprintf(stderr, "---> ERROR: unsupported height map format '%s'!\n",
+			filePath.c_str());
+		return nullptr;
+	}
+}
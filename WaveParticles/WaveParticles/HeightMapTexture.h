@@ -0,0 +1,96 @@
+///
+/// Height Map Texture
+///
+/// A Terrain::HeightMap uploaded as a two-channel float texture, such that
+/// shaders can look up the terrain below a position:
+///   R: height
+///   G: field type (HeightMapFieldType, as a float)
+///
+/// The texture covers the simulation domain [-1, 1] x [-1, 1], with field
+/// (0, 0) in the corner at (-1, -1). It is sampled without filtering, since
+/// interpolated field types are meaningless.
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "HeightMap.h"
+
+
+namespace Terrain
+{
+	class HeightMapTexture
+	{
+	private:
+		GLuint _texture;
+		int _size;
+
+	public:
+		HeightMapTexture(const HeightMap& heightMap)
+			: _size(heightMap.GetSize())
+		{
+			glGenTextures(1, &_texture);
+			glBindTexture(GL_TEXTURE_2D, _texture);
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, _size, _size, 0,
+				GL_RG, GL_FLOAT, nullptr);
+
+			glBindTexture(GL_TEXTURE_2D, 0);
+			Update(heightMap);
+		}
+
+		HeightMapTexture(const HeightMapTexture&) = delete;
+		HeightMapTexture& operator= (const HeightMapTexture&) = delete;
+
+		~HeightMapTexture()
+		{
+			glDeleteTextures(1, &_texture);
+		}
+
+		// uploads the whole height map again, which must have the same size
+		void Update(const HeightMap& heightMap)
+		{
+			assert(heightMap.GetSize() == _size);
+
+			// both planes are row-major, as are texture rows
+			std::vector<glm::vec2> texels((size_t)_size * _size);
+			const GLfloat* heights = heightMap.GetHeights();
+			for (int y = 0; y < _size; y++)
+			{
+				for (int x = 0; x < _size; x++)
+				{
+					size_t index = (size_t)y * _size + x;
+					texels[index] = glm::vec2(heights[index], (GLfloat)heightMap.GetType(x, y));
+				}
+			}
+
+			glBindTexture(GL_TEXTURE_2D, _texture);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _size, _size, GL_RG, GL_FLOAT, texels.data());
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		void Bind(GLuint unit) const
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, _texture);
+		}
+
+		GLuint GetTexture() const
+		{
+			return _texture;
+		}
+
+		int GetSize() const
+		{
+			return _size;
+		}
+	};
+}
@@ -0,0 +1,196 @@
+///
+/// Height Query
+///
+/// Batched water height queries at arbitrary positions, e.g. for floating
+/// objects. A batch is submitted at any time during the frame, evaluated by
+/// a small transform feedback pass once the distribution texture of the
+/// frame is complete, and returned one or two frames later, once a fence
+/// says the results have arrived. Nothing ever waits for the GPU.
+///
+/// Positions are in the simulation domain [-1,1]², like the particles.
+/// Heights are sampled from the distribution texture, with its resolution.
+/// For exact heights, see HeightEvaluator.h.
+///
+
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "ShaderWrapper.h"
+
+
+namespace Simulation
+{
+	class HeightQuery
+	{
+	private:
+		enum SlotState { SLOT_FREE, SLOT_SUBMITTED, SLOT_IN_FLIGHT };
+
+		struct Slot
+		{
+			SlotState State = SLOT_FREE;
+			uint64_t Ticket = 0;
+			std::vector<glm::vec2> Positions;
+			GLuint ResultBuffer = 0;
+			GLsizeiptr ResultCapacity = 0; // bytes
+			GLsync Fence = nullptr;
+		};
+
+		// one batch per frame can be in each slot, results usually arrive
+		// within two frames
+		static constexpr int NUM_SLOTS = 3;
+
+		Slot _slots[NUM_SLOTS];
+		GLuint _vao;
+		GLuint _positionBuffer;
+		GLsizeiptr _positionCapacity = 0; // bytes
+		uint64_t _nextTicket = 1;
+
+		static void reserve(GLenum target, GLuint buffer, GLsizeiptr& capacity,
+			GLsizeiptr size, GLenum usage)
+		{
+			glBindBuffer(target, buffer);
+			if (size > capacity)
+			{
+				capacity = std::max(size, 2 * capacity);
+				glBufferData(target, capacity, nullptr, usage);
+			}
+		}
+
+	public:
+		HeightQuery()
+		{
+			glGenVertexArrays(1, &_vao);
+			glGenBuffers(1, &_positionBuffer);
+			for (Slot& slot : _slots)
+			{
+				glGenBuffers(1, &slot.ResultBuffer);
+			}
+		}
+		~HeightQuery()
+		{
+			for (Slot& slot : _slots)
+			{
+				if (slot.Fence != nullptr) glDeleteSync(slot.Fence);
+				glDeleteBuffers(1, &slot.ResultBuffer);
+			}
+			glDeleteBuffers(1, &_positionBuffer);
+			glDeleteVertexArrays(1, &_vao);
+		}
+
+		HeightQuery(const HeightQuery&) = delete;
+		HeightQuery& operator= (const HeightQuery&) = delete;
+
+		// queues the heights at `count` positions, and returns the ticket
+		// their results are reported with. Returns 0 if all slots are busy.
+		uint64_t Submit(const glm::vec2* positions, size_t count)
+		{
+			for (Slot& slot : _slots)
+			{
+				if (slot.State != SLOT_FREE) continue;
+				slot.State = SLOT_SUBMITTED;
+				slot.Ticket = _nextTicket++;
+				slot.Positions.assign(positions, positions + count);
+				return slot.Ticket;
+			}
+			return 0;
+		}
+
+		// evaluates all submitted batches on `distributionTexture`, with the
+		// heightQuery program. Call once the texture is complete for the frame.
+		void Evaluate(Core::Shaders::ShaderWrapper& program, GLuint distributionTexture)
+		{
+			bool isActive = false;
+			for (Slot& slot : _slots)
+			{
+				if (slot.State != SLOT_SUBMITTED) continue;
+				const GLsizei count = (GLsizei)slot.Positions.size();
+
+				if (!isActive)
+				{
+					program.Activate();
+					program.SetUniformTexture("wpdTexture", 0);
+					glActiveTexture(GL_TEXTURE0);
+					glBindTexture(GL_TEXTURE_2D, distributionTexture);
+					glBindVertexArray(_vao);
+					glEnable(GL_RASTERIZER_DISCARD);
+					isActive = true;
+				}
+
+				if (count > 0)
+				{
+					const GLsizeiptr positionSize = count * sizeof(glm::vec2);
+					reserve(GL_ARRAY_BUFFER, _positionBuffer, _positionCapacity, positionSize,
+						GL_STREAM_DRAW);
+					glBufferSubData(GL_ARRAY_BUFFER, 0, positionSize, slot.Positions.data());
+					glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (GLvoid*)0);
+					glEnableVertexAttribArray(0);
+
+					reserve(GL_TRANSFORM_FEEDBACK_BUFFER, slot.ResultBuffer, slot.ResultCapacity,
+						count * sizeof(GLfloat), GL_STREAM_READ);
+					glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, slot.ResultBuffer);
+
+					glBeginTransformFeedback(GL_POINTS);
+					glDrawArrays(GL_POINTS, 0, count);
+					glEndTransformFeedback();
+				}
+
+				slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				slot.State = SLOT_IN_FLIGHT;
+			}
+
+			if (isActive)
+			{
+				glDisable(GL_RASTERIZER_DISCARD);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				glBindVertexArray(0);
+				program.Deactivate();
+			}
+		}
+
+		// calls `report(ticket, heights, count)` for every batch whose results
+		// have arrived, in ticket order: a batch is held back until all batches
+		// submitted before it are reported. `heights` is only valid during the call.
+		template<typename Function>
+		void Poll(Function report)
+		{
+			while (true)
+			{
+				Slot* oldest = nullptr;
+				for (Slot& candidate : _slots)
+				{
+					if (candidate.State != SLOT_IN_FLIGHT) continue;
+					if (oldest == nullptr || candidate.Ticket < oldest->Ticket) oldest = &candidate;
+				}
+				if (oldest == nullptr) return;
+				Slot& slot = *oldest;
+
+				GLenum status = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+				if (status == GL_TIMEOUT_EXPIRED) return;
+				glDeleteSync(slot.Fence);
+				slot.Fence = nullptr;
+				slot.State = SLOT_FREE;
+
+				const size_t count = slot.Positions.size();
+				if (count == 0 || status == GL_WAIT_FAILED)
+				{
+					report(slot.Ticket, (const GLfloat*)nullptr, (size_t)0);
+					continue;
+				}
+
+				glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, slot.ResultBuffer);
+				const GLfloat* heights = (const GLfloat*)glMapBufferRange(
+					GL_TRANSFORM_FEEDBACK_BUFFER, 0, count * sizeof(GLfloat), GL_MAP_READ_BIT);
+				report(slot.Ticket, heights, heights != nullptr ? count : (size_t)0);
+				if (heights != nullptr) glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+				glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+			}
+		}
+	};
+}
@@ -0,0 +1,151 @@
+///
+/// Input Log
+///
+/// Records the key events that drive the simulation, stamped with the
+/// simulation tick they take effect at, and replays them on a later run.
+/// Together with deterministic mode (a fixed seed and a fixed time step,
+/// see SimulationClock.h) a replay repeats the recorded run exactly, e.g.
+/// the same particle storm for every load test.
+///
+/// File layout: an InputLogHeader, followed by 8-byte InputEvent records in
+/// tick order.
+///
+
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+// CUSTOM
+#include "FileIO.h"
+
+
+namespace Simulation
+{
+	struct InputLogHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Seed;       // random seed of the recorded run
+		uint32_t NumEvents;
+		double TimeStep;     // simulated seconds per tick
+		uint64_t EndTick;    // last tick of the recorded run
+	};
+
+	struct InputEvent
+	{
+		uint32_t Tick;       // applied before simulating this tick
+		int16_t Key;         // GLFW key
+		uint8_t Action;      // GLFW_PRESS or GLFW_RELEASE
+		uint8_t _padding;
+	};
+
+	static constexpr uint32_t INPUT_LOG_MAGIC = 0x4E495057; // "WPIN"
+	static constexpr uint32_t INPUT_LOG_VERSION = 1;
+
+	class InputRecorder
+	{
+	private:
+		std::ofstream _file;
+		InputLogHeader _header;
+		uint64_t _tick = 0;
+
+	public:
+		InputRecorder(const std::string& filePath, uint32_t seed, double timeStep)
+			: _file(filePath, std::ios::out | std::ios::binary | std::ios::trunc)
+		{
+			if (!_file.is_open())
+			{
+				std::cerr << "Could not write input log '" << filePath << "'." << std::endl;
+			}
+			_header = { INPUT_LOG_MAGIC, INPUT_LOG_VERSION, seed, 0, timeStep, 0 };
+			_file.write((const char*)&_header, sizeof(_header));
+		}
+
+		~InputRecorder()
+		{
+			if (_file.is_open()) Close(_tick);
+		}
+
+		InputRecorder(const InputRecorder&) = delete;
+		InputRecorder& operator= (const InputRecorder&) = delete;
+
+		bool IsOpen() const { return _file.is_open(); }
+
+		// events recorded from now on take effect at `tick`
+		void SetTick(uint64_t tick) { _tick = tick; }
+
+		// completes the header, the run ended after `endTick`
+		void Close(uint64_t endTick)
+		{
+			_header.EndTick = endTick;
+			_file.seekp(0);
+			_file.write((const char*)&_header, sizeof(_header));
+			_file.close();
+		}
+
+		void Record(int key, int action)
+		{
+			InputEvent event = { (uint32_t)_tick, (int16_t)key, (uint8_t)action, 0 };
+			_file.write((const char*)&event, sizeof(event));
+			_header.NumEvents++;
+		}
+	};
+
+	class InputReplayer
+	{
+	private:
+		InputLogHeader _header;
+		std::vector<InputEvent> _events;
+		size_t _next = 0;
+		bool _isValid = false;
+
+	public:
+		InputReplayer(const std::string& filePath)
+		{
+			Core::FileIO::FileView file(filePath);
+			if (!file.IsOpen() || file.GetSize() < sizeof(InputLogHeader))
+			{
+				std::cerr << "Could not read input log '" << filePath << "'." << std::endl;
+				return;
+			}
+			memcpy(&_header, file.GetData(), sizeof(_header));
+			const size_t size = sizeof(InputLogHeader) + (size_t)_header.NumEvents * sizeof(InputEvent);
+			if (_header.Magic != INPUT_LOG_MAGIC || _header.Version != INPUT_LOG_VERSION ||
+				file.GetSize() < size)
+			{
+				fprintf(stderr, "---> ERROR: '%s' is not a complete input log!\n",
+					filePath.c_str());
+				return;
+			}
+			_events.resize(_header.NumEvents);
+			memcpy(_events.data(), file.GetData() + sizeof(InputLogHeader),
+				_events.size() * sizeof(InputEvent));
+			_isValid = true;
+		}
+
+		bool IsValid() const { return _isValid; }
+		const InputLogHeader& GetHeader() const { return _header; }
+
+		// calls `apply(key, action)` for every event up to and including `tick`
+		template<typename Function>
+		void Replay(uint64_t tick, Function apply)
+		{
+			while (_next < _events.size() && _events[_next].Tick <= tick)
+			{
+				apply((int)_events[_next].Key, (int)_events[_next].Action);
+				_next++;
+			}
+		}
+
+		bool IsFinished(uint64_t tick) const
+		{
+			return tick >= _header.EndTick;
+		}
+	};
+}
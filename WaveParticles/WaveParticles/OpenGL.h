@@ -2,6 +2,7 @@
 
 // GLAD
 #include <glad/glad.h>
+#include "OpenGLExtensions.h"
 
 // GLFW
 #include <GLFW/glfw3.h>
@@ -27,7 +28,7 @@ namespace OpenGL
 	// how many samples we want. Should be either 1, 4, 8, or 16.
 	static constexpr int YGGDRASIL_OPENGL_MULTISAMPLE = 1;
 
-	void InitGLFW()
+	inline void InitGLFW()
 	{
 		if (glfwInit() == GL_FALSE)
 		{
@@ -52,16 +53,19 @@ namespace OpenGL
 		}
 	}
 
-	void InitGLAD()
+	inline void InitGLAD()
 	{
 		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 		{
 			std::cout << "Failed to initialize GLAD" << std::endl;
 			exit(-1);
 		}
+
+		// entry points not covered by the GLAD loader
+		LoadExtensions((GLADloadproc)glfwGetProcAddress);
 	}
 
-	void ApplyOpenGLRenderingSettings()
+	inline void ApplyOpenGLRenderingSettings()
 	{
 		// depth buffering
 		glEnable(GL_DEPTH_TEST);
@@ -78,7 +82,7 @@ namespace OpenGL
 		}
 	}
 
-	void PrintRendererInfo()
+	inline void PrintRendererInfo()
 	{
 		const GLubyte* renderer = glGetString(GL_RENDERER);
 		const GLubyte* version = glGetString(GL_VERSION);
@@ -86,7 +90,7 @@ namespace OpenGL
 		printf("OpenGL version supported %s\n", version);
 	}
 
-	void PrintOpenGLHardwareStats()
+	inline void PrintOpenGLHardwareStats()
 	{
 		std::map<GLenum, const char*> stats;
 		stats[GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS] = "GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS";
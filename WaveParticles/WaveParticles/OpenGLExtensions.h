@@ -0,0 +1,157 @@
+///
+/// OpenGL Extensions
+///
+/// The bundled GLAD loader was generated for OpenGL 3.3 only. Entry points
+/// from newer core versions (or extensions) that we make use of are declared
+/// and loaded here instead, using the same naming scheme as GLAD, such that
+/// call sites look like any other OpenGL call.
+///
+/// None of these may be called unless the corresponding availability check
+/// below returns true!
+///
+
+#pragma once
+
+// GLAD
+#include <glad/glad.h>
+
+// STANDARD
+#include <string.h>
+
+
+// --- OPENGL 4.0 - TESSELLATION --- //
+#ifndef GL_VERSION_4_0
+#define GL_PATCHES                        0x000E
+#define GL_PATCH_VERTICES                 0x8E72
+#define GL_TESS_EVALUATION_SHADER         0x8E87
+#define GL_TESS_CONTROL_SHADER            0x8E88
+#define GL_MAX_TESS_GEN_LEVEL             0x8E7E
+
+typedef void (APIENTRYP PFNGLPATCHPARAMETERIPROC)(GLenum pname, GLint value);
+inline PFNGLPATCHPARAMETERIPROC glad_glPatchParameteri = nullptr;
+#define glPatchParameteri glad_glPatchParameteri
+#endif
+
+
+// --- OPENGL 4.1 / ARB_get_program_binary - PROGRAM BINARIES --- //
+#ifndef GL_VERSION_4_1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize,
+	GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat,
+	const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+inline PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary = nullptr;
+inline PFNGLPROGRAMBINARYPROC glad_glProgramBinary = nullptr;
+inline PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri = nullptr;
+#define glGetProgramBinary glad_glGetProgramBinary
+#define glProgramBinary glad_glProgramBinary
+#define glProgramParameteri glad_glProgramParameteri
+#endif
+
+
+// --- KHR_parallel_shader_compile / ARB_parallel_shader_compile --- //
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR          0x91B1
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+inline PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glad_glMaxShaderCompilerThreadsKHR = nullptr;
+#define glMaxShaderCompilerThreadsKHR glad_glMaxShaderCompilerThreadsKHR
+#endif
+
+
+namespace OpenGL
+{
+	// true if the current context is at least version `major`.`minor`
+	inline bool IsVersionSupported(int major, int minor)
+	{
+		GLint contextMajor = 0;
+		GLint contextMinor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+		glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+
+		return contextMajor > major ||
+			(contextMajor == major && contextMinor >= minor);
+	}
+
+	// true if the current context exposes the extension `name`
+	inline bool IsExtensionSupported(const char* name)
+	{
+		GLint numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+		for (GLint i = 0; i < numExtensions; i++)
+		{
+			const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (ext && strcmp(ext, name) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// tessellation shaders are core since OpenGL 4.0
+	inline bool IsTessellationSupported()
+	{
+		return glPatchParameteri != nullptr && IsVersionSupported(4, 0);
+	}
+
+	// program binaries are core since OpenGL 4.1, but a driver may
+	// still support zero binary formats
+	inline bool IsProgramBinarySupported()
+	{
+		if (glGetProgramBinary == nullptr || glProgramBinary == nullptr ||
+			glProgramParameteri == nullptr)
+		{
+			return false;
+		}
+		if (!IsVersionSupported(4, 1) && !IsExtensionSupported("GL_ARB_get_program_binary"))
+		{
+			return false;
+		}
+
+		GLint numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		return numFormats > 0;
+	}
+
+	// the KHR and ARB variants of parallel shader compilation share
+	// enum values, and only differ in the name of the thread count function
+	//
+	// Queried once, since this is polled while waiting for shader programs.
+	inline bool IsParallelShaderCompileSupported()
+	{
+		static const bool isSupported = glMaxShaderCompilerThreadsKHR != nullptr &&
+			(IsExtensionSupported("GL_KHR_parallel_shader_compile") ||
+				IsExtensionSupported("GL_ARB_parallel_shader_compile"));
+		return isSupported;
+	}
+
+	// loads every entry point declared above. Must be called after GLAD
+	// has been initialized, with the same loader function.
+	inline void LoadExtensions(GLADloadproc load)
+	{
+#ifndef GL_VERSION_4_0
+		glad_glPatchParameteri = (PFNGLPATCHPARAMETERIPROC)load("glPatchParameteri");
+#endif
+#ifndef GL_VERSION_4_1
+		glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+		glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+		glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+#endif
+#ifndef GL_KHR_parallel_shader_compile
+		glad_glMaxShaderCompilerThreadsKHR =
+			(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+		if (glad_glMaxShaderCompilerThreadsKHR == nullptr)
+		{
+			glad_glMaxShaderCompilerThreadsKHR =
+				(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+		}
+#endif
+	}
+}
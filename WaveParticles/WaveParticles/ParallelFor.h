@@ -0,0 +1,53 @@
+#pragma once
+
+// STANDARD
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+
+namespace Utilities
+{
+	// number of worker threads to use, at least 1
+	inline unsigned int GetNumWorkerThreads()
+	{
+		unsigned int count = std::thread::hardware_concurrency();
+		return (count > 0) ? count : 1;
+	}
+
+	// calls `function(begin, end)` on contiguous sub-ranges of [0, `count`),
+	// in parallel, and returns once all of them are done. Each call should
+	// only write to data belonging to its own range.
+	template<typename Function>
+	void ParallelFor(size_t count, Function function,
+		unsigned int numThreads = GetNumWorkerThreads())
+	{
+		numThreads = (unsigned int)std::min<size_t>(std::max(numThreads, 1u), count);
+		if (numThreads <= 1)
+		{
+			if (count > 0) function((size_t)0, count);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		threads.reserve(numThreads - 1);
+		const size_t chunk = (count + numThreads - 1) / numThreads;
+		for (unsigned int i = 1; i < numThreads; i++)
+		{
+			size_t begin = i * chunk;
+			size_t end = std::min(begin + chunk, count);
+			if (begin < end)
+			{
+				threads.emplace_back(function, begin, end);
+			}
+		}
+
+		// the calling thread takes the first range
+		function((size_t)0, std::min(chunk, count));
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
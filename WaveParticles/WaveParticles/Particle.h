@@ -33,10 +33,6 @@ public:
 
 class PackedWaveParticle
 {
-private:
-	static bool propagate;
-	static bool createRemote;
-
 public:
 	// (Position.x, Position.y, PropagationAngle, DispersionAngle)
 	glm::vec4 paramVec1;
@@ -47,30 +43,31 @@ public:
 	// (Radius, Amplitude, nBorderFrames)
 	glm::vec4 paramVec3;
 
-	static void TogglePropagate() { propagate = !propagate; }
-	static void ToggleCreateRemote() { createRemote = !createRemote; }
-
-	static void GenerateRandom(PackedWaveParticle& particle)
+	// a random particle from `random`, emitted at simulation time `time`.
+	// `propagate` emits a ring rather than a single, smaller particle, and
+	// `createRemote` places it outside of the domain.
+	static void GenerateRandom(PackedWaveParticle& particle, GLfloat time, CounterRandom& random,
+		bool propagate = true, bool createRemote = false)
 	{
 		glm::vec2 pos;
-		if (PackedWaveParticle::createRemote) {
-			pos.x = Random::NextFloat(1.0f, 2.0f);
-			pos.y = Random::NextFloat(1.0f, 2.0f);
+		if (createRemote) {
+			pos.x = random.NextFloat(1.0f, 2.0f);
+			pos.y = random.NextFloat(1.0f, 2.0f);
 		}
 		else {
-			pos.x = Random::NextFloat(-1.0f, 1.0f);
-			pos.y = Random::NextFloat(-1.0f, 1.0f);
+			pos.x = random.NextFloat(-1.0f, 1.0f);
+			pos.y = random.NextFloat(-1.0f, 1.0f);
 		}
 
-		GLfloat propAngle = Random::NextFloat(0.0f, glm::two_pi<GLfloat>());
-		GLfloat amplitudeBias = Random::NextPositiveNegativeBias();
-		GLfloat amplitude = amplitudeBias * ((PackedWaveParticle::propagate) ? 15.0f : 5.0f);
+		GLfloat propAngle = random.NextFloat(0.0f, glm::two_pi<GLfloat>());
+		GLfloat amplitudeBias = (random.NextUint() & 1u) ? 1.0f : -1.0f;
+		GLfloat amplitude = amplitudeBias * (propagate ? 15.0f : 5.0f);
 
 		// (Position.x, Position.y, PropagationAngle, DispersionAngle)
-		particle.paramVec1 = glm::vec4(pos.x, pos.y, propAngle, (PackedWaveParticle::propagate) ? glm::pi<GLfloat>() * 2.0f : 0.0f);
+		particle.paramVec1 = glm::vec4(pos.x, pos.y, propAngle, propagate ? glm::pi<GLfloat>() * 2.0f : 0.0f);
 
 		// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
-		particle.paramVec2 = glm::vec4(pos.x, pos.y, glfwGetTime(), 0.20f * amplitudeBias);
+		particle.paramVec2 = glm::vec4(pos.x, pos.y, time, 0.20f * amplitudeBias);
 
 		// (Radius, Amplitude, nBorderFrames)
 		particle.paramVec3 = glm::vec4(0.025f, amplitude, 0.0f, 0.0f);
@@ -90,7 +87,4 @@ public:
 	* Speed / AmplitudeSign
 	* DispersionAngle
 	*/
-};
-
-bool PackedWaveParticle::propagate = true;
-bool PackedWaveParticle::createRemote = false;
\ No newline at end of file
+};
\ No newline at end of file
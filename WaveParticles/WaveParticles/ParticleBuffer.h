@@ -0,0 +1,118 @@
+///
+/// Particle Buffer
+///
+/// The pair of vertex buffers the propagation pass ping-pongs between:
+/// one is read as vertex input while transform feedback writes the other.
+///
+/// Transform feedback cannot grow its output, and silently drops whatever
+/// does not fit. The buffers therefore start at an initial capacity and
+/// are grown geometrically on demand, up to a fixed budget, after which
+/// the caller must limit its output instead (see World.h).
+///
+
+#pragma once
+
+// STANDARD
+#include <algorithm>
+#include <cstdio>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "Particle.h"
+
+
+namespace Simulation
+{
+	class ParticleBuffer
+	{
+	private:
+		GLuint _buffers[2];
+		size_t _capacity; // particles per buffer
+		size_t _budget;   // largest capacity allowed
+
+		static GLsizeiptr getByteSize(size_t count)
+		{
+			return (GLsizeiptr)(count * sizeof(PackedWaveParticle));
+		}
+
+	public:
+		ParticleBuffer(size_t initialCapacity, size_t budget)
+			: _capacity(std::min(initialCapacity, budget)), _budget(budget)
+		{
+			glGenBuffers(2, _buffers);
+			for (GLuint buffer : _buffers)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, buffer);
+				glBufferData(GL_ARRAY_BUFFER, getByteSize(_capacity), nullptr, GL_STATIC_DRAW);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		~ParticleBuffer()
+		{
+			glDeleteBuffers(2, _buffers);
+		}
+
+		ParticleBuffer(const ParticleBuffer&) = delete;
+		ParticleBuffer& operator= (const ParticleBuffer&) = delete;
+
+		// makes room for at least `count` particles, doubling the capacity as
+		// often as needed, but never beyond the budget. The first `keep`
+		// particles of buffer `keepIndex` are preserved, the rest of both
+		// buffers is undefined afterwards. Returns false if `count` exceeds
+		// the budget, in which case the buffers have grown to the budget.
+		bool Reserve(size_t count, int keepIndex, size_t keep)
+		{
+			if (count <= _capacity) return true;
+
+			size_t capacity = _capacity;
+			while (capacity < count && capacity < _budget) capacity *= 2;
+			capacity = std::min(capacity, _budget);
+			if (capacity > _capacity)
+			{
+				GLuint buffers[2];
+				glGenBuffers(2, buffers);
+				for (GLuint buffer : buffers)
+				{
+					glBindBuffer(GL_ARRAY_BUFFER, buffer);
+					glBufferData(GL_ARRAY_BUFFER, getByteSize(capacity), nullptr, GL_STATIC_DRAW);
+				}
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+				// copied on the GPU, without a round trip through the CPU
+				keep = std::min(keep, _capacity);
+				if (keep > 0)
+				{
+					glBindBuffer(GL_COPY_READ_BUFFER, _buffers[keepIndex]);
+					glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[keepIndex]);
+					glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+						getByteSize(keep));
+					glBindBuffer(GL_COPY_READ_BUFFER, 0);
+					glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				}
+
+				glDeleteBuffers(2, _buffers);
+				_buffers[0] = buffers[0];
+				_buffers[1] = buffers[1];
+
+				printf("Particle buffers grown from %zu to %zu particles\n", _capacity, capacity);
+				_capacity = capacity;
+			}
+			return count <= _capacity;
+		}
+
+		GLuint GetBuffer(int index) const
+		{
+			return _buffers[index];
+		}
+
+		size_t GetCapacity() const
+		{
+			return _capacity;
+		}
+
+		size_t GetBudget() const
+		{
+			return _budget;
+		}
+	};
+}
@@ -0,0 +1,114 @@
+///
+/// Particle Event Queue
+///
+/// Calendar queue of particle events, for the event-driven propagation in
+/// EventDrivenPropagation.h. Time is divided into buckets of equal width,
+/// and an event is stored in the bucket its time falls into, modulo the
+/// number of buckets. Each bucket is a small min-heap, so insertion and
+/// removal cost O(log n) of the bucket size only, and advancing the time
+/// only visits the buckets in between.
+///
+/// Events far in the future simply wait in their bucket for a later
+/// revolution. Entries are never removed early: an event that is no longer
+/// valid is recognized by its outdated generation when it fires.
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace Simulation
+{
+	struct ParticleEvent
+	{
+		double Time;
+		uint32_t Particle;   // slot of the particle
+		uint32_t Generation; // slot generation when the event was scheduled
+	};
+
+	class ParticleEventQueue
+	{
+	private:
+		double _bucketWidth;
+		std::vector<std::vector<ParticleEvent>> _buckets; // power of two
+		size_t _bucketMask;
+		int64_t _currentBucket = 0; // absolute bucket of the current time
+		size_t _size = 0;
+
+		// std heaps are max-heaps, so the comparison is reversed. Ties are
+		// broken by particle, such that the order never depends on the heap.
+		static bool later(const ParticleEvent& a, const ParticleEvent& b)
+		{
+			return (a.Time != b.Time) ? a.Time > b.Time : a.Particle > b.Particle;
+		}
+
+		int64_t getBucket(double time) const
+		{
+			return (int64_t)std::floor(time / _bucketWidth);
+		}
+
+	public:
+		// `bucketWidth` in seconds, about a frame. Events more than
+		// `numBuckets` x `bucketWidth` ahead share buckets with earlier ones.
+		ParticleEventQueue(double bucketWidth = 1.0 / 120.0, size_t numBuckets = 1024)
+			: _bucketWidth(bucketWidth)
+		{
+			size_t count = 1;
+			while (count < numBuckets) count <<= 1;
+			_buckets.resize(count);
+			_bucketMask = count - 1;
+		}
+
+		// the queue will not return events before `time`
+		void Reset(double time)
+		{
+			for (std::vector<ParticleEvent>& bucket : _buckets) bucket.clear();
+			_currentBucket = getBucket(time);
+			_size = 0;
+		}
+
+		// events before the current time fire on the next call to PopUntil
+		void Push(const ParticleEvent& event)
+		{
+			int64_t bucketIndex = std::max(getBucket(event.Time), _currentBucket);
+			std::vector<ParticleEvent>& bucket = _buckets[(size_t)bucketIndex & _bucketMask];
+			bucket.push_back(event);
+			std::push_heap(bucket.begin(), bucket.end(), later);
+			_size++;
+		}
+
+		// calls `fire(event)` for every event up to and including `time`, in
+		// order. Events pushed by `fire` are returned as well, if they are due.
+		template<typename Function>
+		void PopUntil(double time, Function fire)
+		{
+			const int64_t lastBucket = getBucket(time);
+			for (int64_t b = _currentBucket; b <= lastBucket; b++)
+			{
+				_currentBucket = b;
+				std::vector<ParticleEvent>& bucket = _buckets[(size_t)b & _bucketMask];
+
+				// only events of this revolution, until the last bucket
+				const double end = (b < lastBucket) ? (double)(b + 1) * _bucketWidth : time;
+				while (!bucket.empty() && (bucket.front().Time < end ||
+					(b == lastBucket && bucket.front().Time <= end)))
+				{
+					std::pop_heap(bucket.begin(), bucket.end(), later);
+					ParticleEvent event = bucket.back();
+					bucket.pop_back();
+					_size--;
+					fire(event);
+				}
+			}
+			_currentBucket = std::max(_currentBucket, lastBucket);
+		}
+
+		// number of pending events, including outdated ones
+		size_t GetSize() const { return _size; }
+	};
+}
@@ -3,8 +3,9 @@
 // STANDARD
 #include <random>
 #include <cstddef>
-#include <memory> // std::unique_ptr<T>
+#include <cstdint>
 #include <limits> // std::numeric_limits
+#include <atomic>
 #include <cassert>
 
 // CUSTOM
@@ -13,149 +14,272 @@
 
 namespace Utilities
 {
-	template<class T>class RandomGenerator
+	// Counter-based random numbers: the n-th number of a stream is a hash of
+	// (key, n), where the key is derived from a seed and a stream number.
+	// There is no state besides the counter, so any position can be jumped
+	// to, and bulk fills are independent per element. The key is mixed into
+	// the counter twice, before and after a round of hashing, such that the
+	// streams of different keys are not shifted copies of one sequence.
+	//
+	// The hash is Chris Wellons' "lowbias32" integer hash.
+	class CounterRandom
 	{
 	private:
-		static RandomGenerator<T>* _instance;
+		uint32_t _key;
+		uint32_t _counter;
 
-		typedef typename std::conditional<
-			std::is_floating_point<T>::value,
-			std::uniform_real_distribution<T>,
-			std::uniform_int_distribution<T>>::type dist_type;
+	public:
+		static constexpr uint32_t WEYL_INCREMENT = 0x9E3779B9u;
 
-		std::random_device* _rdev;
-		std::default_random_engine* _re;
+		static uint32_t Hash(uint32_t x)
+		{
+			x ^= x >> 16;
+			x *= 0x7FEB352Du;
+			x ^= x >> 15;
+			x *= 0x846CA68Bu;
+			x ^= x >> 16;
+			return x;
+		}
 
-		RandomGenerator<T>() {
-			_rdev = new std::random_device();
-			_re = new std::default_random_engine((*_rdev)());
+		static uint32_t MakeKey(uint32_t seed, uint32_t stream)
+		{
+			return Hash(seed ^ Hash(stream + WEYL_INCREMENT));
 		}
-		~RandomGenerator<T>() {
-			delete _rdev;
-			delete _re;
+
+		// the number at position `counter` of the stream with `key`
+		static uint32_t At(uint32_t key, uint32_t counter)
+		{
+			return Hash(Hash(counter ^ key) + key);
 		}
 
-	public:
-		static RandomGenerator<T>& GetInstance() {
-			if (!RandomGenerator<T>::_instance) {
-				RandomGenerator<T>::_instance = new RandomGenerator<T>();
+		// uniform in [0, 1), from the upper 24 bits
+		static GLfloat ToFloat(uint32_t value)
+		{
+			return (GLfloat)(value >> 8) * (1.0f / 16777216.0f);
+		}
+
+		CounterRandom(uint32_t seed = 0, uint32_t stream = 0)
+			: _key(MakeKey(seed, stream)), _counter(0)
+		{
+		}
+
+		uint32_t NextUint()
+		{
+			return At(_key, _counter++);
+		}
+
+		// uniform in [min, max], without modulo bias
+		uint32_t NextUint(uint32_t min, uint32_t max)
+		{
+			assert(min <= max);
+			uint64_t range = (uint64_t)max - min + 1;
+			return min + (uint32_t)((NextUint() * range) >> 32);
+		}
+
+		int32_t NextInt(int32_t min, int32_t max)
+		{
+			assert(min <= max);
+			return (int32_t)((int64_t)min + NextUint(0, (uint32_t)((int64_t)max - min)));
+		}
+
+		// uniform in [0, 1)
+		GLfloat NextFloat()
+		{
+			return ToFloat(NextUint());
+		}
+
+		// uniform in [min, max)
+		GLfloat NextFloat(GLfloat min, GLfloat max)
+		{
+			return min + (max - min) * NextFloat();
+		}
+
+		// uniform in [0, 1), with 53 random bits
+		GLdouble NextDouble()
+		{
+			uint64_t high = NextUint() >> 5;
+			uint64_t low = NextUint() >> 6;
+			return (GLdouble)((high << 26) | low) * (1.0 / 9007199254740992.0);
+		}
+
+		// writes `count` uniform floats in [min, max) to `output`
+		void Fill(GLfloat* output, size_t count, GLfloat min, GLfloat max)
+		{
+			const GLfloat scale = max - min;
+			for (size_t i = 0; i < count; i++)
+			{
+				output[i] = min + scale * ToFloat(At(_key, _counter + (uint32_t)i));
 			}
-			return *_instance;
+			_counter += (uint32_t)count;
 		}
 
-		T NextRandomValue(const T min, const T max) {
-			dist_type uni(min, max); // (inclusive, inclusive)
-			return static_cast<T>(uni(*_re));
+		// writes `count` uniform 32-bit integers to `output`
+		void Fill(uint32_t* output, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				output[i] = At(_key, _counter + (uint32_t)i);
+			}
+			_counter += (uint32_t)count;
 		}
 
-		// delete copy-constructor and assignment constructor
-		RandomGenerator<T>(const RandomGenerator<T>&) = delete;
-		RandomGenerator<T>& operator= (const RandomGenerator<T>) = delete;
+		uint32_t GetKey() const { return _key; }
+		uint32_t GetCounter() const { return _counter; }
+		void SetCounter(uint32_t counter) { _counter = counter; }
 	};
 
-	template<class T>
-	RandomGenerator<T>* RandomGenerator<T>::_instance = nullptr;
-
-	// TODO: Provide standard template instantiations here !
 
 	namespace Random
 	{
+		namespace Detail
+		{
+			// a different sequence every run, until Seed is called
+			inline uint32_t getDefaultSeed()
+			{
+				std::random_device device;
+				return device();
+			}
+
+			inline std::atomic<uint32_t> seed{ getDefaultSeed() };
+			inline std::atomic<uint32_t> seedEpoch{ 0 };   // bumped by Seed
+			inline std::atomic<uint32_t> nextStream{ 0 };  // one stream per thread
+
+			struct ThreadStream
+			{
+				uint32_t Stream = nextStream.fetch_add(1);
+				uint32_t Epoch = seedEpoch.load();
+				CounterRandom Generator{ seed.load(), Stream };
+			};
+		}
+
+		// the generator of the calling thread. Threads get their streams in the
+		// order they first use it, so the thread calling first gets stream 0.
+		inline CounterRandom& GetThreadGenerator()
+		{
+			thread_local Detail::ThreadStream thread;
+			uint32_t epoch = Detail::seedEpoch.load(std::memory_order_acquire);
+			if (thread.Epoch != epoch)
+			{
+				thread.Generator = CounterRandom(Detail::seed.load(), thread.Stream);
+				thread.Epoch = epoch;
+			}
+			return thread.Generator;
+		}
+
+		// restarts every thread's stream from `seed`, for reproducible runs
+		inline void Seed(uint32_t seed)
+		{
+			Detail::seed.store(seed);
+			Detail::seedEpoch.fetch_add(1, std::memory_order_release);
+		}
+
+		inline uint32_t GetSeed()
+		{
+			return Detail::seed.load();
+		}
+
+		// bulk generation, `count` floats in [min, max)
+		inline void Fill(GLfloat* output, size_t count, GLfloat min, GLfloat max)
+		{
+			GetThreadGenerator().Fill(output, count, min, max);
+		}
+
+
 		// integer values
-		GLint NextInt(GLint min, GLint max) {
+		inline GLint NextInt(GLint min, GLint max) {
 			if (min > max) {
-				int tmp = min;
+				GLint tmp = min;
 				min = max;
 				max = tmp;
 			}
-			return RandomGenerator<GLint>::GetInstance().NextRandomValue(min, max);
+			return GetThreadGenerator().NextInt(min, max);
 		}
 
-		GLuint NextUint(GLuint min, GLuint max) {
+		inline GLuint NextUint(GLuint min, GLuint max) {
 			if (min > max) {
-				int tmp = min;
+				GLuint tmp = min;
 				min = max;
 				max = tmp;
 			}
-			return RandomGenerator<GLuint>::GetInstance().NextRandomValue(min, max);
+			return GetThreadGenerator().NextUint(min, max);
 		}
 
 
 		// floating-point values
-		GLfloat NextPositiveNegativeBias() {
-			GLfloat val = RandomGenerator<GLfloat>::GetInstance().NextRandomValue(-1.0f, 1.0f);
-			return (val <= 0.0f) ? -1.0f : 1.0f;
+		inline GLfloat NextPositiveNegativeBias() {
+			return (GetThreadGenerator().NextUint() & 1u) ? 1.0f : -1.0f;
 		}
 
-		GLfloat NextFloat(GLfloat min, GLfloat max) {
+		inline GLfloat NextFloat(GLfloat min, GLfloat max) {
 			if (min > max) {
-				int tmp = min;
+				GLfloat tmp = min;
 				min = max;
 				max = tmp;
 			}
-			return RandomGenerator<GLfloat>::GetInstance().NextRandomValue(min, max);
+			return GetThreadGenerator().NextFloat(min, max);
 		}
 
-		GLfloat NextFloat()
+		inline GLfloat NextFloat()
 		{
 			constexpr GLfloat min = std::numeric_limits<GLfloat>::min();
 			constexpr GLfloat max = std::numeric_limits<GLfloat>::max();
-			return RandomGenerator<GLfloat>::GetInstance().NextRandomValue(min, max);
+			return GetThreadGenerator().NextFloat(min, max);
 		}
 
-		GLfloat NextPositiveFloat(GLfloat max) {
+		inline GLfloat NextPositiveFloat(GLfloat max) {
 			assert(max > 0.0f);
-			return RandomGenerator<GLfloat>::GetInstance().NextRandomValue(0.0f, max);
+			return GetThreadGenerator().NextFloat(0.0f, max);
 		}
 
-		GLfloat NextPositiveFloat() {
+		inline GLfloat NextPositiveFloat() {
 			constexpr GLfloat max = std::numeric_limits<GLfloat>::max();
-			return RandomGenerator<GLfloat>::GetInstance().NextRandomValue(0.0f, max);
+			return GetThreadGenerator().NextFloat(0.0f, max);
 		}
 
-		GLfloat NextNegativeFloat(GLfloat min) {
+		inline GLfloat NextNegativeFloat(GLfloat min) {
 			assert(min < 0.0f);
-			return RandomGenerator<GLfloat>::GetInstance().NextRandomValue(min, 0.0f);
+			return GetThreadGenerator().NextFloat(min, 0.0f);
 		}
 
-		GLfloat NextNegativeFloat() {
+		inline GLfloat NextNegativeFloat() {
 			constexpr GLfloat min = std::numeric_limits<GLfloat>::min();
-			return RandomGenerator<GLfloat>::GetInstance().NextRandomValue(min, 0.0f);
+			return GetThreadGenerator().NextFloat(min, 0.0f);
 		}
 
-		GLdouble NextDouble(GLdouble min, GLdouble max) {
+		inline GLdouble NextDouble(GLdouble min, GLdouble max) {
 			if (min > max) {
-				int tmp = min;
+				GLdouble tmp = min;
 				min = max;
 				max = tmp;
 			}
-			return RandomGenerator<GLdouble>::GetInstance().NextRandomValue(min, max);
+			return min + (max - min) * GetThreadGenerator().NextDouble();
 		}
 
 
 		// floating-point values clamped in the range [0,1]
-		GLclampf NextClampedFloat() {
-			return RandomGenerator<GLclampf>::GetInstance().NextRandomValue(0.0f, 1.0f);
+		inline GLclampf NextClampedFloat() {
+			return GetThreadGenerator().NextFloat();
 		}
 
-		GLclampd NextClampedDouble() {
-			return RandomGenerator<GLclampd>::GetInstance().NextRandomValue(0.0, 1.0);
+		inline GLclampd NextClampedDouble() {
+			return GetThreadGenerator().NextDouble();
 		}
 
 
 		// normalized floating-point values in the range [-1,1]
-		GLfloat NextNormalizedFloat() {
-			return RandomGenerator<GLfloat>::GetInstance().NextRandomValue(-1.0f, 1.0f);
+		inline GLfloat NextNormalizedFloat() {
+			return GetThreadGenerator().NextFloat(-1.0f, 1.0f);
 		}
 
-		GLdouble NextNormalizedDouble() {
-			return RandomGenerator<GLdouble>::GetInstance().NextRandomValue(-1.0, 1.0);
+		inline GLdouble NextNormalizedDouble() {
+			return NextDouble(-1.0, 1.0);
 		}
 
 
 		// random probability-based choice
-		GLboolean GetRandomChoice(GLclampf probability)
+		inline GLboolean GetRandomChoice(GLclampf probability)
 		{
 			return NextClampedFloat() <= probability;
 		}
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,258 @@
+///
+/// Shader Cache
+///
+/// On-disk cache of linked shader program binaries, such that programs
+/// only need to be compiled from source once per driver. Each program is
+/// stored in its own file, named after a key which is a hash of:
+///   - every stage type and source,
+///   - the transform feedback varyings (if any),
+///   - the driver vendor, renderer, and version strings.
+///
+/// A cached binary may still be rejected by the driver (e.g. after a driver
+/// update that keeps the version string), in which case the caller falls
+/// back to compiling from source, and the stale entry is overwritten.
+///
+
+#pragma once
+
+// STANDARD
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "FileIO.h"
+#include "Hash.h"
+
+
+namespace Core::Shaders::ShaderCache
+{
+	// file layout: header, followed by `Length` bytes of program binary
+	struct CacheFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint32_t Format;
+		uint32_t Length;
+	};
+
+	static constexpr uint32_t CACHE_FILE_MAGIC = 0x42535057; // "WPSB"
+	static constexpr uint32_t CACHE_FILE_VERSION = 1;
+	const std::string CACHE_FILE_EXTENSION = ".bin";
+
+	// cache settings, shared by all shader programs
+	struct CacheSettings
+	{
+		bool Enabled = true;
+		bool Checked = false;   // has driver support been queried?
+		bool Supported = false; // does the driver support program binaries?
+		std::string Directory = "..|shaderCache";
+	};
+
+	inline CacheSettings& GetSettings()
+	{
+		static CacheSettings settings;
+		return settings;
+	}
+
+	inline void SetEnabled(bool enabled)
+	{
+		GetSettings().Enabled = enabled;
+	}
+
+	// `path` uses '|' as separator, as for shader program paths
+	inline void SetDirectory(const char* path)
+	{
+		GetSettings().Directory = path;
+	}
+
+	// true if the cache is enabled and the driver can use it
+	inline bool IsActive()
+	{
+		CacheSettings& settings = GetSettings();
+		if (!settings.Checked)
+		{
+			settings.Supported = OpenGL::IsProgramBinarySupported();
+			settings.Checked = true;
+		}
+		return settings.Enabled && settings.Supported;
+	}
+
+	// start a new key, which depends on the driver in use
+	inline uint64_t BeginKey()
+	{
+		uint64_t key = Utilities::Hash::FNV1A_64_OFFSET;
+		const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		for (GLenum name : driverStrings)
+		{
+			const char* str = (const char*)glGetString(name);
+			key = Utilities::Hash::Fnv1a64(std::string(str ? str : ""), key);
+		}
+		return key;
+	}
+
+	inline uint64_t AddStageToKey(uint64_t key, GLenum type, const std::string& source)
+	{
+		key = Utilities::Hash::Fnv1a64(&type, sizeof(type), key);
+		return Utilities::Hash::Fnv1a64(source, key);
+	}
+
+	inline uint64_t AddVaryingsToKey(uint64_t key, const char** outputs, int numOutputs)
+	{
+		key = Utilities::Hash::Fnv1a64(&numOutputs, sizeof(numOutputs), key);
+		for (int i = 0; i < numOutputs; i++)
+		{
+			key = Utilities::Hash::Fnv1a64(std::string(outputs[i]), key);
+		}
+		return key;
+	}
+
+	inline std::string GetCacheFilePath(uint64_t key)
+	{
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+		return Core::FileIO::getPlatformPath(GetSettings().Directory.c_str())
+			+ name + CACHE_FILE_EXTENSION;
+	}
+
+	// creates a program from the binary cached under `key`.
+	// Returns 0 if there is no (valid) entry, or if the driver rejects it.
+	inline GLuint LoadProgram(uint64_t key)
+	{
+		if (!IsActive())
+		{
+			return 0;
+		}
+
+		const std::string filePath = GetCacheFilePath(key);
+		Core::FileIO::FileView file(filePath);
+		if (!file.IsOpen() || file.GetSize() < sizeof(CacheFileHeader))
+		{
+			return 0;
+		}
+
+		CacheFileHeader header;
+		memcpy(&header, file.GetData(), sizeof(header));
+		if (header.Magic != CACHE_FILE_MAGIC || header.Version != CACHE_FILE_VERSION ||
+			header.Key != key || file.GetSize() - sizeof(header) < header.Length)
+		{
+			return 0;
+		}
+
+		// the binary is passed to the driver straight from the mapped file
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, header.Format, file.GetData() + sizeof(header),
+			(GLsizei)header.Length);
+
+		GLint result = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &result);
+		if (!result)
+		{
+			// not an error, the binary will be rebuilt from source
+			printf("---> NOTE: cached shader binary '%s' was rejected by the driver\n",
+				filePath.c_str());
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		return program;
+	}
+
+	// must be called on a program before linking it, for
+	// StoreProgram to be able to retrieve its binary
+	inline void PrepareProgram(GLuint program)
+	{
+		if (IsActive())
+		{
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+	}
+
+	// a name next to `filePath` no other process or thread writes to, such
+	// that concurrent runs storing the same key never share a file
+	inline std::string GetTempFilePath(const std::string& filePath)
+	{
+		static std::atomic<uint32_t> counter{ 0 };
+#ifdef WIN32
+		const unsigned long processId = (unsigned long)GetCurrentProcessId();
+#else
+		const unsigned long processId = (unsigned long)getpid();
+#endif
+		char suffix[48];
+		snprintf(suffix, sizeof(suffix), ".%lu.%u.tmp", processId, (unsigned)counter++);
+		return filePath + suffix;
+	}
+
+	// stores the binary of a successfully linked `program` under `key`
+	inline void StoreProgram(uint64_t key, GLuint program)
+	{
+		if (!IsActive())
+		{
+			return;
+		}
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+		{
+			return;
+		}
+
+		CacheFileHeader header;
+		header.Magic = CACHE_FILE_MAGIC;
+		header.Version = CACHE_FILE_VERSION;
+		header.Key = key;
+
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		GLsizei written = 0;
+		glGetProgramBinary(program, length, &written, &format, binary.data());
+		header.Format = format;
+		header.Length = (uint32_t)written;
+
+		std::error_code error;
+		std::filesystem::create_directories(
+			Core::FileIO::getPlatformFilePath(GetSettings().Directory.c_str()), error);
+
+		// written next to the cache file, and renamed over it once complete,
+		// such that an interrupted write never leaves a truncated binary
+		const std::string filePath = GetCacheFilePath(key);
+		const std::string tempPath = GetTempFilePath(filePath);
+		{
+			std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::cerr << "Could not write shader cache file '"
+					<< tempPath << "'." << std::endl;
+				std::filesystem::remove(tempPath, error);
+				return;
+			}
+
+			file.write((const char*)&header, sizeof(header));
+			file.write(binary.data(), written);
+			file.close();
+			if (file.fail())
+			{
+				std::cerr << "Could not write shader cache file '"
+					<< tempPath << "'." << std::endl;
+				std::filesystem::remove(tempPath, error);
+				return;
+			}
+		}
+
+		std::filesystem::rename(tempPath, filePath, error);
+		if (error)
+		{
+			std::cerr << "Could not replace shader cache file '"
+				<< filePath << "'." << std::endl;
+			std::filesystem::remove(tempPath, error);
+		}
+	}
+}
@@ -6,29 +6,41 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
-#include <filesystem>
 #include <map>
 
 // CUSTOM
 #include "OpenGL.h"
 #include "ShaderType.h"
+#include "ShaderCache.h"
+#include "ShaderPreprocessor.h"
 #include "FileIO.h"
 
 
 namespace Core::Shaders
 {
-	// load, compile, and return a shader of the specified `type`
-	GLuint loadShader(GLenum type, const char* path)
+	// a single stage of a shader program, i.e. the contents of one .shd file
+	struct ShaderStage
 	{
-		// load shader file
-		std::string shader_str = Core::FileIO::readFileContents(path);
-		const char* shader_src = shader_str.c_str();
+		GLenum Type;
+		std::string Source;
+	};
 
-		// create shader
-		GLuint shader = glCreateShader(type);
+	// a shader program which has been submitted for compilation and linking,
+	// but whose status has not been checked yet (see finishShaderProgram)
+	struct PendingShaderProgram
+	{
+		GLuint Program = 0;
+		std::vector<GLuint> Shaders;
+		std::vector<ShaderStage> Stages;
+		uint64_t CacheKey = 0;
+		bool Finished = false; // loaded from cache, or already finished
+	};
+
+	// human-readable name of a shader stage, or an empty string if unsupported
+	inline std::string getShaderTypeName(GLenum type)
+	{
 		std::string shader_type;
 
-		// Compile vertex shader
 		switch (type)
 		{
 		case GL_VERTEX_SHADER:
@@ -40,22 +52,16 @@ namespace Core::Shaders
 		case GL_FRAGMENT_SHADER:
 			shader_type = "fragment";
 			break;
-
-			/*
-		case GL_COMPUTE_SHADER:
-			shader_type = "compute";
-			std::cerr << "Error: Unsupported shader type ("
-				<< shader_type << " shader)"
-				<< std::endl;
-			break;
 		case GL_TESS_CONTROL_SHADER:
 			shader_type = "tesselation control";
-			std::cerr << "Error: Unsupported shader type ("
-				<< shader_type << " shader)"
-				<< std::endl;
 			break;
 		case GL_TESS_EVALUATION_SHADER:
 			shader_type = "tesselation evaluation";
+			break;
+
+			/*
+		case GL_COMPUTE_SHADER:
+			shader_type = "compute";
 			std::cerr << "Error: Unsupported shader type ("
 				<< shader_type << " shader)"
 				<< std::endl;
@@ -63,11 +69,34 @@ namespace Core::Shaders
 			*/
 
 		default:
+			break;
+		}
+		return shader_type;
+	}
+
+	// start compiling a shader of the specified `type` from `source`,
+	// without waiting for the result
+	inline GLuint submitShader(GLenum type, const std::string& source)
+	{
+		const char* shader_src = source.c_str();
+
+		if (getShaderTypeName(type).empty())
+		{
 			std::cerr << "Error: Unrecognized shader type" << std::endl;
 			return 0;
 		}
+
+		// create shader
+		GLuint shader = glCreateShader(type);
 		glShaderSource(shader, 1, &shader_src, NULL);
 		glCompileShader(shader);
+		return shader;
+	}
+
+	// blocks until `shader` has compiled, and prints any errors
+	inline bool checkShaderCompileStatus(GLuint shader, GLenum type)
+	{
+		const std::string shader_type = getShaderTypeName(type);
 
 		// check if compilation was successful
 		GLint result = GL_FALSE;
@@ -86,191 +115,465 @@ namespace Core::Shaders
 			fprintf(stderr, "%s\n", &shader_err[0]);
 		}
 
+		return result == GL_TRUE;
+	}
+
+	// compile and return a shader of the specified `type` from `source`
+	inline GLuint compileShader(GLenum type, const std::string& source)
+	{
+		GLuint shader = submitShader(type, source);
+		if (shader != 0)
+		{
+			checkShaderCompileStatus(shader, type);
+		}
 		return shader;
 	}
 
+	// load, compile, and return a shader of the specified `type`
+	inline GLuint loadShader(GLenum type, const char* path)
+	{
+		return compileShader(type, Core::FileIO::readFileContents(path));
+	}
+
 	const std::string SHADER_FILE_EXTENSION = ".shd";
 
+	// file name (without extension) of each shader stage
+	inline const char* getShaderFileName(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_VERTEX_SHADER: return "vertex";
+		case GL_GEOMETRY_SHADER: return "geometry";
+		case GL_FRAGMENT_SHADER: return "fragment";
+		case GL_TESS_CONTROL_SHADER: return "tessControl";
+		case GL_TESS_EVALUATION_SHADER: return "tessEvaluation";
+		default: return "";
+		}
+	}
+
 
-	GLuint LoadVertexShader(const std::string& shaderDir)
+	inline GLuint LoadVertexShader(const std::string& shaderDir)
 	{
 		std::string filePath = shaderDir + "vertex" + SHADER_FILE_EXTENSION;
 		return loadShader(GL_VERTEX_SHADER, filePath.c_str());
 	}
 
-	GLuint LoadGeometryShader(const std::string& shaderDir)
+	inline GLuint LoadGeometryShader(const std::string& shaderDir)
 	{
 		std::string filePath = shaderDir + "geometry" + SHADER_FILE_EXTENSION;
 		return loadShader(GL_GEOMETRY_SHADER, filePath.c_str());
 	}
 
-	GLuint LoadFragmentShader(const std::string& shaderDir)
+	inline GLuint LoadFragmentShader(const std::string& shaderDir)
 	{
 		std::string filePath = shaderDir + "fragment" + SHADER_FILE_EXTENSION;
 		return loadShader(GL_FRAGMENT_SHADER, filePath.c_str());
 	}
 
+	inline GLuint LoadTessControlShader(const std::string& shaderDir)
+	{
+		std::string filePath = shaderDir + "tessControl" + SHADER_FILE_EXTENSION;
+		return loadShader(GL_TESS_CONTROL_SHADER, filePath.c_str());
+	}
 
-	GLuint LoadTransformFeedbackShaderProgram(const char* path,
-		TransformFeedbackShaderType type, const char** outputs, int numOutputs)
+	inline GLuint LoadTessEvaluationShader(const std::string& shaderDir)
 	{
-		std::vector<GLuint> shaders;
-		const std::string shaderDir = Core::FileIO::getPlatformPath(path);
+		std::string filePath = shaderDir + "tessEvaluation" + SHADER_FILE_EXTENSION;
+		return loadShader(GL_TESS_EVALUATION_SHADER, filePath.c_str());
+	}
 
-		std::cout << "Testing TF shader outputs:" << std::endl;
-		for (int i = 0; i < numOutputs; i++)
+
+	// read and preprocess the source of every stage in `types` from `shaderDir`
+	inline std::vector<ShaderStage> readShaderStages(const std::string& shaderDir,
+		const std::vector<GLenum>& types, const ShaderDefines& defines)
+	{
+		std::vector<ShaderStage> stages;
+		for (GLenum type : types)
 		{
-			std::cout << outputs[i] << std::endl;
+			std::string filePath = shaderDir + getShaderFileName(type) + SHADER_FILE_EXTENSION;
+			stages.push_back({ type, preprocessShaderSource(
+				Core::FileIO::readFileContents(filePath), filePath, defines) });
 		}
-		std::cout << std::endl;
+		return stages;
+	}
+
+	// check if uniforms declared in the stage sources are linked and used correctly
+	inline void validateUniforms(GLuint program, const std::vector<ShaderStage>& stages)
+	{
+		std::map<std::string, std::string> uniforms;
+		char uniformType[20];
+		char uniformName[50];
+		uniformType[19] = '\0';
+		uniformName[49] = '\0';
+		for (const ShaderStage& stage : stages)
+		{
+			size_t begin = 0;
+			while (begin < stage.Source.size())
+			{
+				size_t end = stage.Source.find('\n', begin);
+				if (end == std::string::npos) end = stage.Source.size();
+				std::string line = stage.Source.substr(begin, end - begin);
+				begin = end + 1;
+
+				int i = sscanf(line.c_str(), "uniform %19s %49s;\n",
+					uniformType, uniformName);
+				if (i == 2)
+				{
+					std::string name = uniformName;
+					size_t semicolon = name.find_first_of(";");
+					if (semicolon != std::string::npos) uniformName[semicolon] = '\0';
+					uniforms[uniformName] = uniformType;
+				}
+			}
+		}
+		for (auto it = uniforms.begin(); it != uniforms.end(); it++)
+		{
+			if (glGetUniformLocation(program, it->first.c_str()) < 0)
+			{
+				printf("---> WARNING: '%s' of type %s is not an active uniform!\n",
+					it->first.c_str(), it->second.c_str());
+			}
+		}
+	}
 
+	// number of components of a uniform of type `type`, and whether they
+	// are read/written as floats, signed, or unsigned integers
+	inline int getUniformComponents(GLenum type, GLenum& baseType)
+	{
 		switch (type)
 		{
-		case TF_SHADER_TYPE_V:
-			printf("Loading V shader program '%s'\n", shaderDir.c_str());
-			shaders.push_back(LoadVertexShader(shaderDir));
-			break;
-		case TF_SHADER_TYPE_VG:
-			printf("Loading VG shader program '%s'\n", shaderDir.c_str());
-			shaders.push_back(LoadVertexShader(shaderDir));
-			shaders.push_back(LoadGeometryShader(shaderDir));
-			break;
+		case GL_FLOAT: baseType = GL_FLOAT; return 1;
+		case GL_FLOAT_VEC2: baseType = GL_FLOAT; return 2;
+		case GL_FLOAT_VEC3: baseType = GL_FLOAT; return 3;
+		case GL_FLOAT_VEC4: baseType = GL_FLOAT; return 4;
+		case GL_FLOAT_MAT2: baseType = GL_FLOAT; return 4;
+		case GL_FLOAT_MAT3: baseType = GL_FLOAT; return 9;
+		case GL_FLOAT_MAT4: baseType = GL_FLOAT; return 16;
+		case GL_INT: baseType = GL_INT; return 1;
+		case GL_INT_VEC2: baseType = GL_INT; return 2;
+		case GL_INT_VEC3: baseType = GL_INT; return 3;
+		case GL_INT_VEC4: baseType = GL_INT; return 4;
+		case GL_BOOL: baseType = GL_INT; return 1;
+		case GL_UNSIGNED_INT: baseType = GL_UNSIGNED_INT; return 1;
+		case GL_UNSIGNED_INT_VEC2: baseType = GL_UNSIGNED_INT; return 2;
+		case GL_UNSIGNED_INT_VEC3: baseType = GL_UNSIGNED_INT; return 3;
+		case GL_UNSIGNED_INT_VEC4: baseType = GL_UNSIGNED_INT; return 4;
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_BUFFER:
+		case GL_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+			baseType = GL_INT; return 1;
 		default:
-			std::cerr << "Error: Unrecognized transform feedback shader type\n";
-			exit(-1);
+			return 0;
 		}
+	}
 
-		GLuint program = glCreateProgram();
+	// copies the current value of every uniform (outside uniform blocks)
+	// which exists with the same name and type in both programs, e.g. to
+	// keep the state of a program across a reload
+	inline void copyUniformValues(GLuint from, GLuint to)
+	{
+		GLint previousProgram = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+		glUseProgram(to);
+
+		GLint numUniforms = 0;
+		GLint maxNameLength = 0;
+		glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &numUniforms);
+		glGetProgramiv(from, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+		std::vector<GLchar> nameBuffer(maxNameLength > 1 ? maxNameLength : 1);
+
+		// large enough for a mat4
+		GLfloat floats[16];
+		GLint ints[16];
+		GLuint uints[16];
+
+		for (GLint i = 0; i < numUniforms; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(from, (GLuint)i, (GLsizei)nameBuffer.size(),
+				&length, &size, &type, nameBuffer.data());
+
+			GLenum baseType = 0;
+			int components = getUniformComponents(type, baseType);
+			if (components == 0)
+			{
+				continue;
+			}
 
-		// attach all loaded shaders
-		for (std::vector<GLuint>::iterator it = shaders.begin();
-			it != shaders.end(); it++)
+			std::string name(nameBuffer.data(), length);
+			size_t bracket = name.find('[');
+			if (bracket != std::string::npos) name.resize(bracket);
+
+			for (GLint element = 0; element < size; element++)
+			{
+				std::string elementName = (size > 1)
+					? name + "[" + std::to_string(element) + "]" : name;
+				GLint fromLocation = glGetUniformLocation(from, elementName.c_str());
+				GLint toLocation = glGetUniformLocation(to, elementName.c_str());
+				if (fromLocation < 0 || toLocation < 0)
+				{
+					continue;
+				}
+
+				switch (baseType)
+				{
+				case GL_FLOAT:
+					glGetUniformfv(from, fromLocation, floats);
+					switch (type)
+					{
+					case GL_FLOAT: glUniform1fv(toLocation, 1, floats); break;
+					case GL_FLOAT_VEC2: glUniform2fv(toLocation, 1, floats); break;
+					case GL_FLOAT_VEC3: glUniform3fv(toLocation, 1, floats); break;
+					case GL_FLOAT_VEC4: glUniform4fv(toLocation, 1, floats); break;
+					case GL_FLOAT_MAT2: glUniformMatrix2fv(toLocation, 1, GL_FALSE, floats); break;
+					case GL_FLOAT_MAT3: glUniformMatrix3fv(toLocation, 1, GL_FALSE, floats); break;
+					case GL_FLOAT_MAT4: glUniformMatrix4fv(toLocation, 1, GL_FALSE, floats); break;
+					}
+					break;
+				case GL_INT:
+					glGetUniformiv(from, fromLocation, ints);
+					switch (components)
+					{
+					case 1: glUniform1iv(toLocation, 1, ints); break;
+					case 2: glUniform2iv(toLocation, 1, ints); break;
+					case 3: glUniform3iv(toLocation, 1, ints); break;
+					case 4: glUniform4iv(toLocation, 1, ints); break;
+					}
+					break;
+				case GL_UNSIGNED_INT:
+					glGetUniformuiv(from, fromLocation, uints);
+					switch (components)
+					{
+					case 1: glUniform1uiv(toLocation, 1, uints); break;
+					case 2: glUniform2uiv(toLocation, 1, uints); break;
+					case 3: glUniform3uiv(toLocation, 1, uints); break;
+					case 4: glUniform4uiv(toLocation, 1, uints); break;
+					}
+					break;
+				}
+			}
+		}
+
+		glUseProgram(previousProgram);
+	}
+
+	// starts creating a program from `stages`, either from the shader cache, or
+	// by compiling and linking the sources. If `numOutputs` > 0 the program
+	// captures `outputs` with transform feedback.
+	//
+	// Nothing waits for the driver here, so several programs can be submitted
+	// before any of them is finished, allowing drivers to compile in parallel.
+	inline PendingShaderProgram beginShaderProgram(std::vector<ShaderStage> stages,
+		const char** outputs, int numOutputs)
+	{
+		PendingShaderProgram pending;
+
+		pending.CacheKey = ShaderCache::BeginKey();
+		for (const ShaderStage& stage : stages)
 		{
-			glAttachShader(program, *it);
+			pending.CacheKey = ShaderCache::AddStageToKey(pending.CacheKey,
+				stage.Type, stage.Source);
 		}
+		pending.CacheKey = ShaderCache::AddVaryingsToKey(pending.CacheKey,
+			outputs, numOutputs);
 
-		// tell OpenGL which output attributes to capture in the
-		// transform feedback buffer (TFB)
-		glTransformFeedbackVaryings(program, numOutputs, outputs, GL_INTERLEAVED_ATTRIBS);
+		pending.Program = ShaderCache::LoadProgram(pending.CacheKey);
+		if (pending.Program != 0)
+		{
+			printf("  (loaded from shader cache)\n");
+			pending.Finished = true;
+			return pending;
+		}
 
-		// check if linking was successful
-		glLinkProgram(program);
-		GLint result = GL_FALSE;
-		glGetProgramiv(program, GL_LINK_STATUS, &result);
+		for (const ShaderStage& stage : stages)
+		{
+			pending.Shaders.push_back(submitShader(stage.Type, stage.Source));
+		}
 
-		// if linking did not succeed, print the error message
-		if (!result)
+		pending.Program = glCreateProgram();
+
+		// attach all loaded shaders
+		for (std::vector<GLuint>::iterator it = pending.Shaders.begin();
+			it != pending.Shaders.end(); it++)
 		{
-			fprintf(stderr, "---> ERROR: linking shader program:\n");
-			int logLength;
-			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
-			std::vector<GLchar> programError((logLength > 1) ? logLength : 1);
-			glGetProgramInfoLog(program, logLength, NULL, &programError[0]);
-			std::cout << &programError[0] << std::endl;
+			glAttachShader(pending.Program, *it);
 		}
 
-		// perform cleanup
-		for (std::vector<GLuint>::iterator it = shaders.begin();
-			it != shaders.end(); it++)
+		// tell OpenGL which output attributes to capture in the
+		// transform feedback buffer (TFB)
+		if (numOutputs > 0)
 		{
-			glDeleteShader(*it);
+			glTransformFeedbackVaryings(pending.Program, numOutputs, outputs,
+				GL_INTERLEAVED_ATTRIBS);
 		}
 
-		
+		ShaderCache::PrepareProgram(pending.Program);
+		glLinkProgram(pending.Program);
 
-		return program;
+		pending.Stages = std::move(stages);
+		return pending;
 	}
 
-	GLuint LoadShaderProgram(const char* path, ShaderType type)
+	// true if finishShaderProgram would not block. Always true, unless
+	// the driver supports parallel shader compilation.
+	inline bool isShaderProgramReady(const PendingShaderProgram& pending)
 	{
-		std::vector<GLuint> shaders;
-		const std::string shaderDir = Core::FileIO::getPlatformPath(path);
-
-		switch (type)
+		if (pending.Finished || !OpenGL::IsParallelShaderCompileSupported())
 		{
-		case SHADER_TYPE_VF:
-			printf("Loading VF shader program '%s'\n", shaderDir.c_str());
-			shaders.push_back(LoadVertexShader(shaderDir));
-			shaders.push_back(LoadFragmentShader(shaderDir));
-			break;
-		case SHADER_TYPE_VGF:
-			printf("Loading VGF shader program '%s'\n", shaderDir.c_str());
-			shaders.push_back(LoadVertexShader(shaderDir));
-			shaders.push_back(LoadGeometryShader(shaderDir));
-			shaders.push_back(LoadFragmentShader(shaderDir));
-			break;
-		default:
-			std::cerr << "Error: Unrecognized shader type\n";
-			exit(-1);
+			return true;
 		}
+		GLint completed = GL_FALSE;
+		glGetProgramiv(pending.Program, GL_COMPLETION_STATUS_KHR, &completed);
+		return completed == GL_TRUE;
+	}
 
-		GLuint program = glCreateProgram();
+	// waits for a submitted program to finish linking, prints any errors,
+	// and returns the program
+	inline GLuint finishShaderProgram(PendingShaderProgram& pending)
+	{
+		if (pending.Finished)
+		{
+			return pending.Program;
+		}
 
-		// attach all loaded shaders
-		for (std::vector<GLuint>::iterator it = shaders.begin();
-			it != shaders.end(); it++)
+		// compile errors are more helpful than the resulting link error
+		for (size_t i = 0; i < pending.Shaders.size(); i++)
 		{
-			glAttachShader(program, *it);
+			checkShaderCompileStatus(pending.Shaders[i], pending.Stages[i].Type);
 		}
 
 		// check if linking was successful
-		glLinkProgram(program);
 		GLint result = GL_FALSE;
-		glGetProgramiv(program, GL_LINK_STATUS, &result);
+		glGetProgramiv(pending.Program, GL_LINK_STATUS, &result);
 
 		// if linking did not succeed, print the error message
 		if (!result)
 		{
 			fprintf(stderr, "---> ERROR: linking shader program:\n");
 			int logLength;
-			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+			glGetProgramiv(pending.Program, GL_INFO_LOG_LENGTH, &logLength);
 			std::vector<GLchar> programError((logLength > 1) ? logLength : 1);
-			glGetProgramInfoLog(program, logLength, NULL, &programError[0]);
+			glGetProgramInfoLog(pending.Program, logLength, NULL, &programError[0]);
 			std::cout << &programError[0] << std::endl;
 		}
 
 		// perform cleanup
-		for (std::vector<GLuint>::iterator it = shaders.begin();
-			it != shaders.end(); it++)
+		for (std::vector<GLuint>::iterator it = pending.Shaders.begin();
+			it != pending.Shaders.end(); it++)
 		{
 			glDeleteShader(*it);
 		}
+		pending.Shaders.clear();
 
-		// check if uniforms are linked and used correctly
-		std::map<std::string, std::string> uniforms;
-		char uniformType[20];
-		char uniformName[50];
-		uniformType[19] = '\0';
-		uniformName[49] = '\0';
-		for (const auto& entry : std::filesystem::directory_iterator(shaderDir))
+		if (result)
 		{
-			std::ifstream file;
-			file.open(entry.path());
+			validateUniforms(pending.Program, pending.Stages);
+			ShaderCache::StoreProgram(pending.CacheKey, pending.Program);
+		}
 
-			std::string line;
-			while (std::getline(file, line))
-			{
-				int i = sscanf(line.c_str(), "uniform %s %s;\n",
-					uniformType, uniformName);
-				if (i == 2)
-				{
-					std::string name = uniformName;
-					uniformName[name.find_first_of(";")] = '\0';
-					uniforms[uniformName] = uniformType;
-				}
-			}
-			file.close();
+		// calling this again is harmless
+		pending.Finished = true;
+		return pending.Program;
+	}
+
+	// creates a program from `stages`, and waits for the result
+	inline GLuint buildShaderProgram(std::vector<ShaderStage> stages,
+		const char** outputs, int numOutputs)
+	{
+		PendingShaderProgram pending = beginShaderProgram(std::move(stages),
+			outputs, numOutputs);
+		return finishShaderProgram(pending);
+	}
+
+
+	inline PendingShaderProgram SubmitTransformFeedbackShaderProgram(const char* path,
+		TransformFeedbackShaderType type, const char** outputs, int numOutputs,
+		const ShaderDefines& defines = {})
+	{
+		std::vector<GLenum> types;
+		const std::string shaderDir = Core::FileIO::getPlatformPath(path);
+
+		std::cout << "Testing TF shader outputs:" << std::endl;
+		for (int i = 0; i < numOutputs; i++)
+		{
+			std::cout << outputs[i] << std::endl;
 		}
-		for (auto it = uniforms.begin(); it != uniforms.end(); it++)
+		std::cout << std::endl;
+
+		switch (type)
 		{
-			if (glGetUniformLocation(program, it->first.c_str()) < 0)
+		case TF_SHADER_TYPE_V:
+			printf("Loading V shader program '%s'\n", shaderDir.c_str());
+			types = { GL_VERTEX_SHADER };
+			break;
+		case TF_SHADER_TYPE_VG:
+			printf("Loading VG shader program '%s'\n", shaderDir.c_str());
+			types = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER };
+			break;
+		default:
+			std::cerr << "Error: Unrecognized transform feedback shader type\n";
+			exit(-1);
+		}
+
+		return beginShaderProgram(readShaderStages(shaderDir, types, defines),
+			outputs, numOutputs);
+	}
+
+	inline PendingShaderProgram SubmitShaderProgram(const char* path, ShaderType type,
+		const ShaderDefines& defines = {})
+	{
+		std::vector<GLenum> types;
+		const std::string shaderDir = Core::FileIO::getPlatformPath(path);
+
+		switch (type)
+		{
+		case SHADER_TYPE_VF:
+			printf("Loading VF shader program '%s'\n", shaderDir.c_str());
+			types = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+			break;
+		case SHADER_TYPE_VGF:
+			printf("Loading VGF shader program '%s'\n", shaderDir.c_str());
+			types = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+			break;
+		case SHADER_TYPE_VTF:
+			if (!OpenGL::IsTessellationSupported())
 			{
-				printf("---> WARNING: '%s' of type %s is not an active uniform!\n",
-					it->first.c_str(), it->second.c_str());
+				fprintf(stderr, "---> ERROR: VTF shader program '%s' requires OpenGL 4.0!\n",
+					shaderDir.c_str());
+				return PendingShaderProgram();
 			}
+			printf("Loading VTF shader program '%s'\n", shaderDir.c_str());
+			types = { GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER,
+				GL_TESS_EVALUATION_SHADER, GL_FRAGMENT_SHADER };
+			break;
+		default:
+			std::cerr << "Error: Unrecognized shader type\n";
+			exit(-1);
 		}
 
-		// done
-		return program;
+		return beginShaderProgram(readShaderStages(shaderDir, types, defines), nullptr, 0);
+	}
+
+	inline GLuint LoadTransformFeedbackShaderProgram(const char* path,
+		TransformFeedbackShaderType type, const char** outputs, int numOutputs,
+		const ShaderDefines& defines = {})
+	{
+		PendingShaderProgram pending =
+			SubmitTransformFeedbackShaderProgram(path, type, outputs, numOutputs, defines);
+		return finishShaderProgram(pending);
+	}
+
+	inline GLuint LoadShaderProgram(const char* path, ShaderType type,
+		const ShaderDefines& defines = {})
+	{
+		PendingShaderProgram pending = SubmitShaderProgram(path, type, defines);
+		return finishShaderProgram(pending);
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,155 @@
+///
+/// Shader Manager
+///
+/// Owns every shader program of the application. Programs are submitted
+/// up front, which only issues compile and link commands to the driver.
+/// Their status is not checked until each program is first used
+/// (see ShaderWrapper::Activate), so drivers supporting
+/// KHR_parallel_shader_compile can build all programs concurrently, and
+/// startup time follows the slowest program rather than the sum of all.
+///
+/// Without driver support, behaviour is the same as constructing each
+/// ShaderWrapper directly, except that errors are reported on first use.
+///
+/// With hot reload enabled, programs whose source files change on disk are
+/// rebuilt while running (see ShaderWrapper::Reload and ShaderWatcher).
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+#include <memory>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "ShaderType.h"
+#include "ShaderLoader.h"
+#include "ShaderWrapper.h"
+#include "ShaderWatcher.h"
+#include "FileIO.h"
+
+
+namespace Core::Shaders
+{
+	class ShaderManager
+	{
+	private:
+		std::vector<std::unique_ptr<ShaderWrapper>> _shaders;
+		std::unique_ptr<ShaderWatcher> _watcher;
+
+	public:
+		ShaderManager()
+		{
+			if (OpenGL::IsParallelShaderCompileSupported())
+			{
+				// let the driver decide the number of compiler threads
+				glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+				printf("Parallel shader compilation enabled\n");
+			}
+		}
+
+		ShaderManager(const ShaderManager&) = delete;
+		ShaderManager& operator= (const ShaderManager&) = delete;
+
+		// the returned reference stays valid for the lifetime of the manager
+		// `defines` specialize the program, see ShaderPreprocessor. The same path
+		// may be submitted several times with different defines.
+		ShaderWrapper& Submit(const char* path, ShaderType type,
+			const ShaderDefines& defines = {})
+		{
+			_shaders.push_back(std::make_unique<ShaderWrapper>(path, type, defines,
+				SubmitShaderProgram(path, type, defines)));
+			return *_shaders.back();
+		}
+
+		ShaderWrapper& Submit(const char* path, TransformFeedbackShaderType type,
+			const char** outputs, int numOutputs, const ShaderDefines& defines = {})
+		{
+			_shaders.push_back(std::make_unique<ShaderWrapper>(path, type, outputs, numOutputs,
+				defines, SubmitTransformFeedbackShaderProgram(path, type, outputs, numOutputs,
+					defines)));
+			return *_shaders.back();
+		}
+
+		// attach the uniform block `blockName` of every program to `binding`,
+		// without waiting for programs that are still being linked
+		void BindUniformBlock(const char* blockName, GLuint binding)
+		{
+			for (auto& shader : _shaders)
+			{
+				shader->BindUniformBlock(blockName, binding);
+			}
+		}
+
+		// true if every submitted program can be used without waiting
+		bool IsReady() const
+		{
+			for (const auto& shader : _shaders)
+			{
+				if (!shader->IsReady()) return false;
+			}
+			return true;
+		}
+
+		// blocks until every submitted program has been linked
+		void FinishAll()
+		{
+			for (auto& shader : _shaders)
+			{
+				shader->Finish();
+			}
+		}
+
+		// start watching the directories of all programs submitted so far,
+		// and the shared include directory
+		void EnableHotReload()
+		{
+			if (!_watcher)
+			{
+				_watcher = std::make_unique<ShaderWatcher>();
+			}
+			for (const auto& shader : _shaders)
+			{
+				_watcher->Watch(FileIO::getPlatformPath(shader->GetName().c_str()));
+			}
+			_watcher->Watch(FileIO::getPlatformPath(GetShaderIncludeDirectory().c_str()));
+		}
+
+		// rebuilds the programs whose source files changed since the last call.
+		// Cheap enough to be called every frame.
+		void PollReload()
+		{
+			if (!_watcher) return;
+
+			const std::string includeDirectory =
+				FileIO::getPlatformPath(GetShaderIncludeDirectory().c_str());
+
+			for (const std::string& directory : _watcher->Poll())
+			{
+				// any program may include the changed file
+				if (directory == includeDirectory)
+				{
+					ReloadAll();
+					return;
+				}
+
+				for (auto& shader : _shaders)
+				{
+					if (FileIO::getPlatformPath(shader->GetName().c_str()) == directory)
+					{
+						shader->Reload();
+					}
+				}
+			}
+		}
+
+		void ReloadAll()
+		{
+			for (auto& shader : _shaders)
+			{
+				shader->Reload();
+			}
+		}
+	};
+}
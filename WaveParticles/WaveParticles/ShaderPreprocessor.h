@@ -0,0 +1,191 @@
+///
+/// Shader Preprocessor
+///
+/// Runs on shader sources before they are handed to the driver, and adds:
+///
+///   - #include "file.glsl", resolved first relative to the including file,
+///     then in the shared include directory (default: "..|shaders|include").
+///     Each file is included at most once per stage, and #line directives
+///     keep compiler messages pointing at the right file and line. Every
+///     file gets its own source string number, in order of inclusion, which
+///     is noted in a comment at the include site.
+///
+///   - #define specializations, injected directly after #version. A shader
+///     can then declare a default with #ifndef, and one source can be built
+///     into several variants, without branching at runtime.
+///
+/// The shader cache key is computed from the preprocessed source, such that
+/// any change to an included file or a define gives a new cache entry.
+///
+
+#pragma once
+
+// STANDARD
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include <cstdio>
+
+// CUSTOM
+#include "FileIO.h"
+
+
+namespace Core::Shaders
+{
+	const std::string SHADER_INCLUDE_EXTENSION = ".glsl";
+
+	// a single `#define Name Value` specialization
+	struct ShaderDefine
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	using ShaderDefines = std::vector<ShaderDefine>;
+
+	// `path` uses '|' as separator, as for shader program paths
+	inline std::string& GetShaderIncludeDirectory()
+	{
+		static std::string directory = "..|shaders|include";
+		return directory;
+	}
+
+	inline void SetShaderIncludeDirectory(const char* path)
+	{
+		GetShaderIncludeDirectory() = path;
+	}
+
+	// directory part of `filePath`, including the trailing separator
+	inline std::string getDirectoryOf(const std::string& filePath)
+	{
+		size_t separator = filePath.find_last_of("/\\");
+		return (separator == std::string::npos) ? "" : filePath.substr(0, separator + 1);
+	}
+
+	namespace Detail
+	{
+		struct PreprocessorState
+		{
+			std::set<std::string> IncludedFiles;
+			int NextSourceString = 1;
+		};
+
+		// returns the file name if `line` is an #include directive
+		inline bool parseInclude(const std::string& line, std::string& fileName)
+		{
+			size_t pos = line.find_first_not_of(" \t");
+			if (pos == std::string::npos || line.compare(pos, 8, "#include") != 0)
+			{
+				return false;
+			}
+			size_t open = line.find('"', pos + 8);
+			size_t close = (open == std::string::npos) ? open : line.find('"', open + 1);
+			if (close == std::string::npos)
+			{
+				return false;
+			}
+			fileName = line.substr(open + 1, close - open - 1);
+			return true;
+		}
+
+		// finds `fileName` next to the including file, or in the include directory
+		inline std::string resolveInclude(const std::string& fileName, const std::string& fromDir)
+		{
+			const std::string candidates[] = {
+				fromDir + fileName,
+				FileIO::getPlatformPath(GetShaderIncludeDirectory().c_str()) + fileName
+			};
+			for (const std::string& candidate : candidates)
+			{
+				std::error_code error;
+				if (std::filesystem::is_regular_file(candidate, error)) return candidate;
+			}
+			return "";
+		}
+
+		// appends `source` to `output` with includes expanded, where the
+		// first line of `source` is line `firstLine` of `filePath`
+		inline void appendSource(const std::string& source, const std::string& filePath,
+			int sourceString, int firstLine, PreprocessorState& state, std::string& output)
+		{
+			const std::string fromDir = getDirectoryOf(filePath);
+			int lineNumber = firstLine - 1;
+			size_t begin = 0;
+			while (begin < source.size())
+			{
+				size_t end = source.find('\n', begin);
+				if (end == std::string::npos) end = source.size();
+				std::string line = source.substr(begin, end - begin);
+				begin = end + 1;
+				lineNumber++;
+
+				std::string fileName;
+				if (!parseInclude(line, fileName))
+				{
+					output += line;
+					output += '\n';
+					continue;
+				}
+
+				std::string includePath = resolveInclude(fileName, fromDir);
+				if (includePath.empty())
+				{
+					fprintf(stderr, "---> ERROR: %s(%d): could not find include file '%s'\n",
+						filePath.c_str(), lineNumber, fileName.c_str());
+					output += "// " + line + '\n';
+					continue;
+				}
+				if (!state.IncludedFiles.insert(includePath).second)
+				{
+					output += "// " + line + " (already included)\n";
+					continue;
+				}
+
+				int includeSourceString = state.NextSourceString++;
+				output += "// " + line + " (source string " +
+					std::to_string(includeSourceString) + ")\n";
+				output += "#line 1 " + std::to_string(includeSourceString) + '\n';
+				appendSource(FileIO::readFileContents(includePath), includePath,
+					includeSourceString, 1, state, output);
+				output += "#line " + std::to_string(lineNumber + 1) + ' ' +
+					std::to_string(sourceString) + '\n';
+			}
+		}
+	}
+
+	// preprocesses `source`, the contents of the shader file `filePath`
+	inline std::string preprocessShaderSource(const std::string& source, const std::string& filePath,
+		const ShaderDefines& defines)
+	{
+		// the #version directive must stay first, so defines go after it
+		size_t bodyBegin = 0;
+		size_t versionPos = source.find("#version");
+		if (versionPos != std::string::npos)
+		{
+			size_t versionEnd = source.find('\n', versionPos);
+			bodyBegin = (versionEnd == std::string::npos) ? source.size() : versionEnd + 1;
+		}
+
+		std::string output = source.substr(0, bodyBegin);
+		for (const ShaderDefine& define : defines)
+		{
+			output += "#define " + define.Name + ' ' + define.Value + '\n';
+		}
+
+		// count the lines before the body, to restore line numbers after the defines
+		int bodyLine = 1;
+		for (size_t i = 0; i < bodyBegin; i++)
+		{
+			if (source[i] == '\n') bodyLine++;
+		}
+		if (!defines.empty())
+		{
+			output += "#line " + std::to_string(bodyLine) + " 0\n";
+		}
+
+		Detail::PreprocessorState state;
+		Detail::appendSource(source.substr(bodyBegin), filePath, 0, bodyLine, state, output);
+		return output;
+	}
+}
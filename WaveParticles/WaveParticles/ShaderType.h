@@ -6,7 +6,8 @@ namespace Core::Shaders
 	typedef enum
 	{
 		SHADER_TYPE_VF,
-		SHADER_TYPE_VGF
+		SHADER_TYPE_VGF,
+		SHADER_TYPE_VTF // vertex, tessellation control/evaluation, fragment
 	} ShaderType;
 
 	// for transform feedback
@@ -0,0 +1,173 @@
+///
+/// Shader Watcher
+///
+/// Reports shader directories whose files have been modified, such that
+/// programs can be rebuilt while the application is running.
+///
+/// On Linux this uses inotify, which costs nothing until a file changes.
+/// On other platforms the modification times of the shader files are
+/// compared instead, at most a few times per second.
+///
+
+#pragma once
+
+// STANDARD
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// CUSTOM
+#include "ShaderLoader.h"
+
+
+namespace Core::Shaders
+{
+	class ShaderWatcher
+	{
+	private:
+		// shader stages and include files
+		static bool isShaderFile(const std::filesystem::path& path)
+		{
+			return path.extension() == SHADER_FILE_EXTENSION ||
+				path.extension() == SHADER_INCLUDE_EXTENSION;
+		}
+
+#ifdef __linux__
+		int _inotify = -1;
+		std::unordered_map<int, std::string> _watches; // watch descriptor -> directory
+#else
+		static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+		std::chrono::steady_clock::time_point _lastPoll;
+		// directory -> newest modification time of its shader files
+		std::unordered_map<std::string, std::filesystem::file_time_type> _watches;
+
+		static std::filesystem::file_time_type getNewestWriteTime(const std::string& directory)
+		{
+			std::filesystem::file_time_type newest{};
+			std::error_code error;
+			for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+			{
+				if (!isShaderFile(entry.path())) continue;
+				auto time = entry.last_write_time(error);
+				if (!error && time > newest) newest = time;
+			}
+			return newest;
+		}
+#endif
+
+	public:
+		ShaderWatcher()
+		{
+#ifdef __linux__
+			_inotify = inotify_init1(IN_NONBLOCK);
+			if (_inotify < 0)
+			{
+				printf("---> WARNING: could not watch shader files for changes\n");
+			}
+#else
+			_lastPoll = std::chrono::steady_clock::now();
+#endif
+		}
+
+		ShaderWatcher(const ShaderWatcher&) = delete;
+		ShaderWatcher& operator= (const ShaderWatcher&) = delete;
+
+		~ShaderWatcher()
+		{
+#ifdef __linux__
+			if (_inotify >= 0) close(_inotify);
+#endif
+		}
+
+		// `directory` is a platform path, as returned by FileIO::getPlatformPath.
+		// Watching the same directory more than once has no effect.
+		void Watch(const std::string& directory)
+		{
+#ifdef __linux__
+			if (_inotify < 0) return;
+			for (const auto& [wd, watched] : _watches)
+			{
+				if (watched == directory) return;
+			}
+			// editors often save by writing a new file and renaming it
+			int wd = inotify_add_watch(_inotify, directory.c_str(),
+				IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (wd < 0)
+			{
+				printf("---> WARNING: could not watch shader directory '%s'\n",
+					directory.c_str());
+				return;
+			}
+			_watches[wd] = directory;
+#else
+			if (_watches.count(directory) == 0)
+			{
+				_watches[directory] = getNewestWriteTime(directory);
+			}
+#endif
+		}
+
+		// returns the directories that changed since the last call, without blocking
+		std::vector<std::string> Poll()
+		{
+			std::vector<std::string> changed;
+			auto addChanged = [&changed](const std::string& directory)
+			{
+				for (const std::string& dir : changed)
+				{
+					if (dir == directory) return;
+				}
+				changed.push_back(directory);
+			};
+
+#ifdef __linux__
+			if (_inotify < 0) return changed;
+
+			alignas(inotify_event) char buffer[4096];
+			while (true)
+			{
+				ssize_t length = read(_inotify, buffer, sizeof(buffer));
+				if (length <= 0) break; // EAGAIN, nothing (more) to read
+
+				for (char* ptr = buffer; ptr < buffer + length; )
+				{
+					const inotify_event* event = (const inotify_event*)ptr;
+					ptr += sizeof(inotify_event) + event->len;
+
+					// ignore swap files and other files written next to the shaders
+					if (event->len == 0 || !isShaderFile(event->name))
+					{
+						continue;
+					}
+
+					auto it = _watches.find(event->wd);
+					if (it != _watches.end()) addChanged(it->second);
+				}
+			}
+#else
+			auto now = std::chrono::steady_clock::now();
+			if (now - _lastPoll < POLL_INTERVAL) return changed;
+			_lastPoll = now;
+
+			for (auto& [directory, lastWrite] : _watches)
+			{
+				auto newest = getNewestWriteTime(directory);
+				if (newest != lastWrite)
+				{
+					lastWrite = newest;
+					addChanged(directory);
+				}
+			}
+#endif
+			return changed;
+		}
+	};
+}
@@ -1,12 +1,30 @@
 #pragma once
 
+// STANDARD
+#include <unordered_map>
+#include <cstring>
+
 // CUSTOM
 #include "ShaderLoader.h"
 #include "ShaderType.h"
+#include "Hash.h"
 
 
 namespace Core::Shaders
 {
+	// name of a uniform, looked up by its hash, and then compared by name in
+	// case two names share a hash. Constructing it from a string
+	// literal can be done at compile time, e.g.
+	//   constexpr UniformName timeUniform("time");
+	struct UniformName
+	{
+		uint32_t Hash;
+		const char* Name;
+
+		constexpr UniformName(const char* name)
+			: Hash(Utilities::Hash::Fnv1a32(name)), Name(name) {}
+	};
+
 	// wrapper class for the functions above
 	class ShaderWrapper {
 	private:
@@ -15,30 +33,220 @@ namespace Core::Shaders
 		GLint64 _lastTime = 0;
 		const std::string _shaderName;
 
+		// how the program was built, such that it can be rebuilt by Reload
+		bool _isTransformFeedback = false;
+		ShaderType _type = SHADER_TYPE_VF;
+		TransformFeedbackShaderType _tfType = TF_SHADER_TYPE_V;
+		std::vector<std::string> _outputs;
+		ShaderDefines _defines;
+
+		// set while the program is still being compiled/linked by the driver,
+		// see ShaderManager
+		bool _isPending = false;
+		PendingShaderProgram _pending;
+
+		// uniform locations by name hash, filled in once the program is linked,
+		// such that setting a uniform never asks the driver for its location.
+		// The name is kept, such that colliding hashes still find their own.
+		struct CachedUniform
+		{
+			std::string Name;
+			GLint Location;
+		};
+		std::unordered_multimap<uint32_t, CachedUniform> _uniformLocations;
+
+		// uniform block name -> binding point, applied once the program is linked
+		std::vector<std::pair<std::string, GLuint>> _uniformBlockBindings;
+
+		void ApplyUniformBlockBinding(const std::string& blockName, GLuint binding)
+		{
+			GLuint index = glGetUniformBlockIndex(_shader, blockName.c_str());
+			if (index != GL_INVALID_INDEX)
+			{
+				glUniformBlockBinding(_shader, index, binding);
+			}
+		}
+
+		// waits for a pending program, the first time it is needed
+		inline void EnsureLinked()
+		{
+			if (_isPending)
+			{
+				_shader = finishShaderProgram(_pending);
+				_pending = PendingShaderProgram();
+				_isPending = false;
+				CacheUniformLocations();
+
+				for (const auto& [blockName, binding] : _uniformBlockBindings)
+				{
+					ApplyUniformBlockBinding(blockName, binding);
+				}
+			}
+		}
+
+		// query every active uniform of the linked program
+		void CacheUniformLocations()
+		{
+			_uniformLocations.clear();
+
+			GLint linked = GL_FALSE;
+			glGetProgramiv(_shader, GL_LINK_STATUS, &linked);
+			if (!linked)
+			{
+				return;
+			}
+
+			GLint numUniforms = 0;
+			GLint maxNameLength = 0;
+			glGetProgramiv(_shader, GL_ACTIVE_UNIFORMS, &numUniforms);
+			glGetProgramiv(_shader, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+			std::vector<GLchar> nameBuffer(maxNameLength > 1 ? maxNameLength : 1);
+			for (GLint i = 0; i < numUniforms; i++)
+			{
+				GLsizei length = 0;
+				GLint size = 0;
+				GLenum type = 0;
+				glGetActiveUniform(_shader, (GLuint)i, (GLsizei)nameBuffer.size(),
+					&length, &size, &type, nameBuffer.data());
+
+				// arrays are reported as "name[0]", but set as "name"
+				std::string name(nameBuffer.data(), length);
+				size_t bracket = name.find('[');
+				if (bracket != std::string::npos) name.resize(bracket);
+
+				// members of uniform blocks have no location
+				GLint location = glGetUniformLocation(_shader, name.c_str());
+				if (location < 0)
+				{
+					continue;
+				}
+
+				uint32_t hash = Utilities::Hash::Fnv1a32(name.c_str());
+				_uniformLocations.emplace(hash, CachedUniform{ std::move(name), location });
+			}
+		}
+
 	protected:
 	public:
 		// TODO: Eliminate uses of char*, and use std::string& instead!
-		ShaderWrapper(const char* path, ShaderType type)
-			: _shaderName(path)
+		// `defines` are injected into every stage, see ShaderPreprocessor
+		ShaderWrapper(const char* path, ShaderType type, const ShaderDefines& defines = {})
+			: _shaderName(path), _type(type), _defines(defines)
+		{
+			_shader = LoadShaderProgram(path, type, defines);
+			CacheUniformLocations();
+		}
+
+		ShaderWrapper(const char* path, TransformFeedbackShaderType type,
+			const char** outputs, int numOutputs, const ShaderDefines& defines = {})
+			: _shaderName(path), _isTransformFeedback(true), _tfType(type),
+			_outputs(outputs, outputs + numOutputs), _defines(defines)
+		{
+			_shader = LoadTransformFeedbackShaderProgram(path, type, outputs, numOutputs,
+				defines);
+			CacheUniformLocations();
+		}
+
+		// takes over a program which has been submitted, but not finished
+		ShaderWrapper(const char* path, ShaderType type, const ShaderDefines& defines,
+			PendingShaderProgram&& pending)
+			: _shaderName(path), _type(type), _defines(defines),
+			_isPending(true), _pending(std::move(pending))
 		{
-			_shader = LoadShaderProgram(path, type);
+			_shader = _pending.Program;
 		}
 
 		ShaderWrapper(const char* path, TransformFeedbackShaderType type,
-			const char** outputs, int numOutputs)
-			: _shaderName(path)
+			const char** outputs, int numOutputs, const ShaderDefines& defines,
+			PendingShaderProgram&& pending)
+			: _shaderName(path), _isTransformFeedback(true), _tfType(type),
+			_outputs(outputs, outputs + numOutputs), _defines(defines),
+			_isPending(true), _pending(std::move(pending))
 		{
-			_shader = LoadTransformFeedbackShaderProgram(path, type, outputs, numOutputs);
+			_shader = _pending.Program;
 		}
 
 		~ShaderWrapper()
 		{
-			glDeleteShader(_shader); // is this needed ?
+			for (GLuint shader : _pending.Shaders)
+			{
+				glDeleteShader(shader);
+			}
+			glDeleteProgram(_shader);
 			glUseProgram(0);
 		}
 
+		// rebuilds the program from its source files. On success the new program
+		// replaces the old one, keeping uniform values and block bindings.
+		// If compiling or linking fails, the old program is kept.
+		bool Reload()
+		{
+			EnsureLinked();
+
+			GLuint program = 0;
+			if (_isTransformFeedback)
+			{
+				std::vector<const char*> outputs;
+				for (const std::string& output : _outputs)
+				{
+					outputs.push_back(output.c_str());
+				}
+				program = LoadTransformFeedbackShaderProgram(_shaderName.c_str(), _tfType,
+					outputs.data(), (int)outputs.size(), _defines);
+			}
+			else
+			{
+				program = LoadShaderProgram(_shaderName.c_str(), _type, _defines);
+			}
+
+			GLint linked = GL_FALSE;
+			if (program != 0)
+			{
+				glGetProgramiv(program, GL_LINK_STATUS, &linked);
+			}
+			if (!linked)
+			{
+				if (program != 0) glDeleteProgram(program);
+				printf("---> WARNING: keeping previous version of '%s'\n", _shaderName.c_str());
+				return false;
+			}
+
+			copyUniformValues(_shader, program);
+
+			// the new program replaces the old one if that was bound
+			GLint currentProgram = 0;
+			glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+			const bool wasBound = (GLuint)currentProgram == _shader;
+			glDeleteProgram(_shader);
+			_shader = program;
+			if (wasBound) glUseProgram(_shader);
+
+			CacheUniformLocations();
+			for (const auto& [blockName, binding] : _uniformBlockBindings)
+			{
+				ApplyUniformBlockBinding(blockName, binding);
+			}
+
+			printf("Reloaded shader program '%s'\n", _shaderName.c_str());
+			return true;
+		}
+
+		// true if the program can be used without waiting for the driver
+		bool IsReady() const
+		{
+			return !_isPending || isShaderProgramReady(_pending);
+		}
+
+		// blocks until the program has been linked
+		void Finish()
+		{
+			EnsureLinked();
+		}
+
 		void Activate()
 		{
+			EnsureLinked();
 			glGetInteger64v(GL_TIMESTAMP, &_lastTime);
 			glUseProgram(_shader);
 		}
@@ -50,11 +258,39 @@ namespace Core::Shaders
 			_deltaTime = nowTime - _lastTime;
 		}
 
-		GLuint GetShader() const
+		GLuint GetShader()
 		{
+			EnsureLinked();
 			return _shader;
 		}
 
+		const std::string& GetName() const
+		{
+			return _shaderName;
+		}
+
+		// attach the uniform block `blockName` to a binding point (see UniformBuffer).
+		// Programs which do not declare the block are left untouched.
+		void BindUniformBlock(const char* blockName, GLuint binding)
+		{
+			_uniformBlockBindings.push_back({ blockName, binding });
+			if (!_isPending)
+			{
+				ApplyUniformBlockBinding(blockName, binding);
+			}
+		}
+
+		// -1 if `name` is not an active uniform, which glUniform* silently ignores
+		GLint GetUniformLocation(UniformName name) const
+		{
+			auto [it, end] = _uniformLocations.equal_range(name.Hash);
+			for (; it != end; ++it)
+			{
+				if (std::strcmp(it->second.Name.c_str(), name.Name) == 0) return it->second.Location;
+			}
+			return -1;
+		}
+
 		void PrintLastMeasuredTime()
 		{
 			double milliseconds = _deltaTime / 1000000.0;
@@ -65,7 +301,7 @@ namespace Core::Shaders
 
 		// the 'number' is an integer between 0 and
 		// GL_MAX_TEXTURE_UNITS (probably 16)
-		void SetUniformTexture(const char* name, GLuint number)
+		void SetUniformTexture(UniformName name, GLuint number)
 		{
 			// TODO: is it ok to compare this way, or do we need to:
 			// glGetIntegerv(GL_MAX_TEXTURE_UNITS, &someIntVariable) ?
@@ -76,82 +312,82 @@ namespace Core::Shaders
 					<< ")" << std::endl;
 			}
 
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform1i(location, number);
 		}
 
-		void SetUniform(const char* name, const glm::mat4* mat)
+		void SetUniform(UniformName name, const glm::mat4* mat)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(*mat));
 		}
 
 		// vector is already allocated
-		void SetUniform(const char* name, const glm::vec2* vec)
+		void SetUniform(UniformName name, const glm::vec2* vec)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform2fv(location, 1, glm::value_ptr(*vec));
 		}
 
 		// vector can be called by value, i.e. not allocated prior to
 		// calling this function
-		void SetUniform(const char* name, const glm::vec2& vec)
+		void SetUniform(UniformName name, const glm::vec2& vec)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform2fv(location, 1, glm::value_ptr(vec));
 		}
 
 		// vector is already allocated
-		void SetUniform(const char* name, const glm::vec3* vec)
+		void SetUniform(UniformName name, const glm::vec3* vec)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform3fv(location, 1, glm::value_ptr(*vec));
 		}
 
 		// vector can be called by value, i.e. not allocated prior to
 		// calling this function
-		void SetUniform(const char* name, const glm::vec3& vec)
+		void SetUniform(UniformName name, const glm::vec3& vec)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform3fv(location, 1, glm::value_ptr(vec));
 		}
 
 		// vector is already allocated
-		void SetUniform(const char* name, const glm::vec4* vec)
+		void SetUniform(UniformName name, const glm::vec4* vec)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform4fv(location, 1, glm::value_ptr(*vec));
 		}
 
 		// vector can be called by value, i.e. not allocated prior to
 		// calling this function
-		void SetUniform(const char* name, const glm::vec4& vec)
+		void SetUniform(UniformName name, const glm::vec4& vec)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform4fv(location, 1, glm::value_ptr(vec));
 		}
 
-		void SetUniform(const char* name, bool b)
+		void SetUniform(UniformName name, bool b)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform1ui(location, b);
 		}
 
-		void SetUniform(const char* name, float f)
+		void SetUniform(UniformName name, float f)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform1f(location, f);
 		}
 
-		void SetUniform(const char* name, int i)
+		void SetUniform(UniformName name, int i)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform1i(location, i);
 		}
 
-		void SetUniform(const char* name, unsigned int i)
+		void SetUniform(UniformName name, unsigned int i)
 		{
-			GLint location = glGetUniformLocation(_shader, name);
+			GLint location = GetUniformLocation(name);
 			glUniform1ui(location, i);
 		}
 	};
@@ -0,0 +1,219 @@
+///
+/// Signed Distance Field
+///
+/// Distance from every field of a height map to the nearest shoreline,
+/// positive over water and negative over land, together with its
+/// normalized gradient, which points away from land. A single lookup thus
+/// tells both whether a position collides with land, and the normal to
+/// reflect about.
+///
+/// Distances are exact Euclidean distances, in fields, computed with the
+/// two-pass distance transform of Felzenszwalb and Huttenlocher
+/// ("Distance Transforms of Sampled Functions", 2012): first along every
+/// column, then along every row, each pass spread over all cores.
+/// Distances are clamped to `maxDistance`, which also bounds the area that
+/// UpdateRegion has to recompute when the terrain changes.
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "HeightMap.h"
+#include "ParallelFor.h"
+
+
+namespace Terrain
+{
+	// (distance, gradient.x, gradient.y) of a single field
+	typedef glm::vec3 SignedDistanceFieldSample;
+
+	class SignedDistanceField
+	{
+	private:
+		static constexpr float FAR_AWAY = 1e20f;
+
+		int _size;
+		float _maxDistance;
+		std::vector<SignedDistanceFieldSample> _samples; // row-major
+
+		// 1D squared distance transform of the n samples of `f`, written to `d`.
+		// `v` and `z` are scratch buffers of n and n + 1 elements.
+		static void DistanceTransform1D(const float* f, float* d, int n, int* v, float* z)
+		{
+			int k = 0;
+			v[0] = 0;
+			z[0] = -FAR_AWAY;
+			z[1] = FAR_AWAY;
+			for (int q = 1; q < n; q++)
+			{
+				// intersection of the parabolas rooted at q and v[k]
+				float fq = f[q] + (float)q * q;
+				float s = (fq - (f[v[k]] + (float)v[k] * v[k])) / (2.0f * (q - v[k]));
+				while (s <= z[k])
+				{
+					k--;
+					s = (fq - (f[v[k]] + (float)v[k] * v[k])) / (2.0f * (q - v[k]));
+				}
+				k++;
+				v[k] = q;
+				z[k] = s;
+				z[k + 1] = FAR_AWAY;
+			}
+
+			k = 0;
+			for (int q = 0; q < n; q++)
+			{
+				while (z[k + 1] < q) k++;
+				float dq = (float)(q - v[k]);
+				d[q] = dq * dq + f[v[k]];
+			}
+		}
+
+		// squared distance from every field of the `width` x `height` grid to
+		// the nearest field which is 0 (the others must be FAR_AWAY), in place
+		static void DistanceTransform2D(std::vector<float>& grid, int width, int height)
+		{
+			// columns
+			Utilities::ParallelFor(width, [&](size_t begin, size_t end)
+			{
+				std::vector<float> f(height), d(height), z(height + 1);
+				std::vector<int> v(height);
+				for (size_t x = begin; x < end; x++)
+				{
+					for (int y = 0; y < height; y++) f[y] = grid[(size_t)y * width + x];
+					DistanceTransform1D(f.data(), d.data(), height, v.data(), z.data());
+					for (int y = 0; y < height; y++) grid[(size_t)y * width + x] = d[y];
+				}
+			});
+
+			// rows
+			Utilities::ParallelFor(height, [&](size_t begin, size_t end)
+			{
+				std::vector<float> f(width), z(width + 1);
+				std::vector<int> v(width);
+				for (size_t y = begin; y < end; y++)
+				{
+					float* row = grid.data() + y * width;
+					std::copy(row, row + width, f.begin());
+					DistanceTransform1D(f.data(), row, width, v.data(), z.data());
+				}
+			});
+		}
+
+		// recomputes distances inside [x0, x1) x [y0, y1), reading the terrain
+		// inside [fx0, fx1) x [fy0, fy1), which must contain every field
+		// within `_maxDistance` of the target region
+		void Compute(const HeightMap& heightMap, int x0, int y0, int x1, int y1,
+			int fx0, int fy0, int fx1, int fy1)
+		{
+			const int width = fx1 - fx0;
+			const int height = fy1 - fy0;
+			std::vector<float> toLand((size_t)width * height);
+			std::vector<float> toWater((size_t)width * height);
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					bool land = heightMap.GetType(fx0 + x, fy0 + y) == HEIGHT_FIELD_TYPE_LAND;
+					toLand[(size_t)y * width + x] = land ? 0.0f : FAR_AWAY;
+					toWater[(size_t)y * width + x] = land ? FAR_AWAY : 0.0f;
+				}
+			}
+			DistanceTransform2D(toLand, width, height);
+			DistanceTransform2D(toWater, width, height);
+
+			// the shoreline lies half a field from the centers on either side
+			for (int y = y0; y < y1; y++)
+			{
+				for (int x = x0; x < x1; x++)
+				{
+					size_t index = (size_t)(y - fy0) * width + (x - fx0);
+					float distance = (toLand[index] > 0.0f)
+						? std::sqrt(toLand[index]) - 0.5f
+						: -(std::sqrt(toWater[index]) - 0.5f);
+					_samples[(size_t)y * _size + x].x =
+						std::clamp(distance, -_maxDistance, _maxDistance);
+				}
+			}
+		}
+
+		// central differences, one-sided at the border
+		void ComputeGradients(int x0, int y0, int x1, int y1)
+		{
+			for (int y = y0; y < y1; y++)
+			{
+				for (int x = x0; x < x1; x++)
+				{
+					int xl = std::max(x - 1, 0), xr = std::min(x + 1, _size - 1);
+					int yd = std::max(y - 1, 0), yu = std::min(y + 1, _size - 1);
+					glm::vec2 gradient(
+						GetDistance(xr, y) - GetDistance(xl, y),
+						GetDistance(x, yu) - GetDistance(x, yd));
+					float len = glm::length(gradient);
+					gradient = (len > 0.0f) ? gradient / len : glm::vec2(0.0f);
+
+					SignedDistanceFieldSample& sample = _samples[(size_t)y * _size + x];
+					sample.y = gradient.x;
+					sample.z = gradient.y;
+				}
+			}
+		}
+
+	public:
+		SignedDistanceField(const HeightMap& heightMap, float maxDistance)
+			: _size(heightMap.GetSize()), _maxDistance(maxDistance),
+			_samples((size_t)_size * _size, SignedDistanceFieldSample(0.0f))
+		{
+			Compute(heightMap, 0, 0, _size, _size, 0, 0, _size, _size);
+			ComputeGradients(0, 0, _size, _size);
+		}
+
+		// call after changing the field types inside [x0, x1) x [y0, y1).
+		// Only fields within `maxDistance` of the region are recomputed.
+		// Returns the region that changed, in the same form.
+		glm::ivec4 UpdateRegion(const HeightMap& heightMap, int x0, int y0, int x1, int y1)
+		{
+			assert(heightMap.GetSize() == _size);
+			const int reach = (int)std::ceil(_maxDistance) + 1;
+
+			// distances change within `reach` of the region ...
+			int tx0 = std::max(x0 - reach, 0), ty0 = std::max(y0 - reach, 0);
+			int tx1 = std::min(x1 + reach, _size), ty1 = std::min(y1 + reach, _size);
+
+			// ... and depend on fields within `reach` of those
+			int fx0 = std::max(tx0 - reach, 0), fy0 = std::max(ty0 - reach, 0);
+			int fx1 = std::min(tx1 + reach, _size), fy1 = std::min(ty1 + reach, _size);
+
+			Compute(heightMap, tx0, ty0, tx1, ty1, fx0, fy0, fx1, fy1);
+
+			// gradients read one field further
+			int gx0 = std::max(tx0 - 1, 0), gy0 = std::max(ty0 - 1, 0);
+			int gx1 = std::min(tx1 + 1, _size), gy1 = std::min(ty1 + 1, _size);
+			ComputeGradients(gx0, gy0, gx1, gy1);
+			return glm::ivec4(gx0, gy0, gx1, gy1);
+		}
+
+		int GetSize() const { return _size; }
+		float GetMaxDistance() const { return _maxDistance; }
+
+		// row-major (distance, gradient.x, gradient.y) of every field
+		const SignedDistanceFieldSample* GetSamples() const { return _samples.data(); }
+
+		float GetDistance(int x, int y) const
+		{
+			return _samples[(size_t)y * _size + x].x;
+		}
+
+		glm::vec2 GetGradient(int x, int y) const
+		{
+			const SignedDistanceFieldSample& sample = _samples[(size_t)y * _size + x];
+			return glm::vec2(sample.y, sample.z);
+		}
+	};
+}
@@ -0,0 +1,95 @@
+///
+/// Signed Distance Field Texture
+///
+/// A Terrain::SignedDistanceField uploaded as an RGB32F texture:
+///   R: signed distance to the shoreline, in simulation units
+///   G, B: normalized gradient, pointing away from land
+///
+/// Like HeightMapTexture, it covers the simulation domain [-1, 1] x [-1, 1].
+/// Distances interpolate well, so it is sampled with linear filtering.
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "SignedDistanceField.h"
+
+
+namespace Terrain
+{
+	class SignedDistanceFieldTexture
+	{
+	private:
+		GLuint _texture;
+		int _size;
+
+	public:
+		SignedDistanceFieldTexture(const SignedDistanceField& field)
+			: _size(field.GetSize())
+		{
+			glGenTextures(1, &_texture);
+			glBindTexture(GL_TEXTURE_2D, _texture);
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, _size, _size, 0,
+				GL_RGB, GL_FLOAT, nullptr);
+
+			glBindTexture(GL_TEXTURE_2D, 0);
+			UpdateRegion(field, glm::ivec4(0, 0, _size, _size));
+		}
+
+		SignedDistanceFieldTexture(const SignedDistanceFieldTexture&) = delete;
+		SignedDistanceFieldTexture& operator= (const SignedDistanceFieldTexture&) = delete;
+
+		~SignedDistanceFieldTexture()
+		{
+			glDeleteTextures(1, &_texture);
+		}
+
+		// uploads the fields inside `region` (x0, y0, x1, y1), e.g. as
+		// returned by SignedDistanceField::UpdateRegion
+		void UpdateRegion(const SignedDistanceField& field, glm::ivec4 region)
+		{
+			const int width = region.z - region.x;
+			const int height = region.w - region.y;
+			if (width <= 0 || height <= 0) return;
+
+			// fields -> simulation units, where the domain is 2 units wide
+			const float scale = 2.0f / (float)_size;
+			std::vector<glm::vec3> texels((size_t)width * height);
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					glm::vec3 sample = field.GetSamples()[(size_t)(region.y + y) * _size + region.x + x];
+					sample.x *= scale;
+					texels[(size_t)y * width + x] = sample;
+				}
+			}
+
+			glBindTexture(GL_TEXTURE_2D, _texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, width, height,
+				GL_RGB, GL_FLOAT, texels.data());
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		void Bind(GLuint unit) const
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, _texture);
+		}
+
+		GLuint GetTexture() const
+		{
+			return _texture;
+		}
+	};
+}
@@ -0,0 +1,79 @@
+///
+/// Simulation Clock
+///
+/// The time the simulation runs at, which is either the wall-clock time, or,
+/// in deterministic mode, advanced by exactly one fixed step per tick. The
+/// time of tick n is then computed as n * step, rather than accumulated, so
+/// two runs with the same number of ticks see bit-identical times no matter
+/// how long each frame took.
+///
+/// The wall clock counts seconds since the clock was created, from the
+/// standard library, so the simulation does not depend on GLFW being
+/// initialized by whoever owns the GL context.
+///
+
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <chrono>
+
+// CUSTOM
+#include "OpenGL.h"
+
+
+namespace Simulation
+{
+	class SimulationClock
+	{
+	private:
+		bool _fixedStep;
+		double _step;
+		double _startTime;
+		double _offset = 0.0; // added to the wall-clock time
+		uint64_t _tick = 0;
+		double _time;
+		std::chrono::steady_clock::time_point _epoch = std::chrono::steady_clock::now();
+
+		double getWallTime() const
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - _epoch).count();
+		}
+
+	public:
+		// wall-clock time
+		SimulationClock()
+			: _fixedStep(false), _step(0.0), _startTime(0.0)
+		{
+			_time = _startTime;
+		}
+
+		// simulated time, starting at `startTime` and advancing by `step` per tick
+		SimulationClock(double step, double startTime = 0.0)
+			: _fixedStep(true), _step(step), _startTime(startTime), _time(startTime)
+		{
+		}
+
+		// one tick, usually once per rendered frame
+		void Tick()
+		{
+			_tick++;
+			_time = _fixedStep ? _startTime + (double)_tick * _step : getWallTime() + _offset;
+		}
+
+		// continues from `tick` at `time`, e.g. from a snapshot. A wall clock
+		// keeps running from `time` on.
+		void Restore(uint64_t tick, double time)
+		{
+			_tick = tick;
+			_time = time;
+			if (_fixedStep) _startTime = time - (double)tick * _step;
+			else _offset = time - getWallTime();
+		}
+
+		double GetTime() const { return _time; }
+		uint64_t GetTick() const { return _tick; }
+		bool IsFixedStep() const { return _fixedStep; }
+		double GetStep() const { return _step; }
+	};
+}
@@ -0,0 +1,78 @@
+///
+/// Simulation Uniforms
+///
+/// CPU side of the uniform blocks shared by the wave particle shaders.
+/// Member order, types, and padding must match the std140 blocks declared
+/// in the shaders exactly!
+///
+
+#pragma once
+
+// CUSTOM
+#include "OpenGL.h"
+
+
+namespace Simulation
+{
+	// binding points, see ShaderManager::BindUniformBlock
+	static constexpr GLuint FRAME_UNIFORMS_BINDING = 0;
+	static constexpr GLuint SIMULATION_PARAMETERS_BINDING = 1;
+
+	// updated once per rendered frame
+	//
+	// layout (std140) uniform FrameUniforms
+	// {
+	//     mat4 viewProjection;
+	//     vec4 cameraPosition; // w unused
+	//     float time;
+	//     float mapSize;
+	//     vec4 openBorders;    // (-x, +x, -y, +y)
+	// };
+	struct FrameUniforms
+	{
+		glm::mat4 viewProjection;
+		glm::vec4 cameraPosition;
+		GLfloat time;
+		GLfloat mapSize;
+		GLfloat _padding[2];
+
+		// 1 where the domain continues in a neighbouring tile, see TiledWorld.h
+		glm::vec4 openBorders;
+	};
+
+	// updated only when changed, e.g. while tuning the simulation
+	//
+	// layout (std140) uniform SimulationParameters
+	// {
+	//     float dampingCoefficient;
+	//     float deletionAmplitude;
+	//     float subdivisionRadiusFactor;
+	//     float terrainReflection;
+	//     float shallowWaterSpeedFactor;
+	//     float subdivisionEnabled;
+	//     // padded to 32 bytes
+	// };
+	struct SimulationParameters
+	{
+		// amplitude damping over time, to model viscosity
+		GLfloat dampingCoefficient = 0.001f;
+
+		// particles with a smaller absolute amplitude are deleted
+		GLfloat deletionAmplitude = 0.01f;
+
+		// a particle subdivides once the distance to its neighbours exceeds
+		// this factor times its radius
+		GLfloat subdivisionRadiusFactor = 0.5f;
+
+		// 1 if particles reflect at land fields, 0 if they are absorbed (deleted)
+		GLfloat terrainReflection = 1.0f;
+
+		// speed over shallow water fields, relative to the speed over ocean
+		GLfloat shallowWaterSpeedFactor = 0.5f;
+
+		// 0 while the particle budget is exhausted, see ParticleBuffer
+		GLfloat subdivisionEnabled = 1.0f;
+
+		GLfloat _padding[2] = { 0.0f, 0.0f };
+	};
+}
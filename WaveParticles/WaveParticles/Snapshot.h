@@ -0,0 +1,215 @@
+///
+/// Snapshot
+///
+/// Save and restore of the full simulation state: the particles, the
+/// simulation clock, the random number stream of the world, and the
+/// simulation parameters. Benchmarks can start from a saved storm, rather
+/// than waiting for it to build up.
+///
+/// Only the packed particles are saved. With CPU propagation, the
+/// event-driven engine is rebuilt from them on restore, as when switching
+/// propagation modes, so its bookkeeping (distance travelled since the last
+/// subdivision, subdivision families, held-back subdivisions) starts over.
+/// A restored CPU run therefore does not match the saved one exactly; GPU
+/// runs do.
+///
+/// File layout:
+///   - SnapshotHeader
+///   - NumParticles raw PackedWaveParticle records, exactly as they are in
+///     the particle buffer
+///
+/// The file is memory-mapped when restoring, and the records are uploaded
+/// with a single glBufferSubData straight from the mapping (see
+/// World::LoadParticles). When saving, the particles are copied into a
+/// staging buffer on the GPU, and written only once a fence says the copy
+/// has finished, so the frame never waits for the readback.
+///
+
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "FileIO.h"
+#include "Particle.h"
+#include "SimulationUniforms.h"
+
+
+namespace Simulation
+{
+	static constexpr uint32_t SNAPSHOT_MAGIC = 0x4E535057; // "WPSN"
+	static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+	// SnapshotHeader::Flags
+	static constexpr uint32_t SNAPSHOT_FLAG_PROPAGATE = 1u << 0;
+	static constexpr uint32_t SNAPSHOT_FLAG_CREATE_REMOTE = 1u << 1;
+	static constexpr uint32_t SNAPSHOT_FLAG_CPU_PROPAGATION = 1u << 2;
+
+	struct SnapshotHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t RecordSize;      // sizeof(PackedWaveParticle)
+		uint32_t NumParticles;
+		uint64_t Tick;            // simulation clock
+		double Time;
+		double TimeStep;          // 0 unless deterministic
+		uint32_t Seed;            // random numbers
+		uint32_t RandomCounter;   // position in the stream of the world
+		SimulationParameters Parameters;
+		uint32_t Flags;
+		uint32_t _padding[3];
+	};
+
+	// the records stay aligned to their vec4s inside the mapping
+	static_assert(sizeof(SnapshotHeader) % 16 == 0, "SnapshotHeader must be a multiple of 16 bytes");
+
+	class SnapshotWriter
+	{
+	private:
+		GLuint _stagingBuffer = 0;
+		GLsync _fence = nullptr;
+		SnapshotHeader _header;
+		std::string _filePath;
+
+		void write()
+		{
+			const size_t size = (size_t)_header.NumParticles * sizeof(PackedWaveParticle);
+			std::ofstream file(_filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::cerr << "Could not write snapshot '" << _filePath << "'." << std::endl;
+				return;
+			}
+			file.write((const char*)&_header, sizeof(_header));
+			if (size > 0)
+			{
+				glBindBuffer(GL_COPY_READ_BUFFER, _stagingBuffer);
+				const void* data = glMapBufferRange(GL_COPY_READ_BUFFER, 0,
+					(GLsizeiptr)size, GL_MAP_READ_BIT);
+				if (data != nullptr)
+				{
+					file.write((const char*)data, size);
+				}
+				glUnmapBuffer(GL_COPY_READ_BUFFER);
+				glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			}
+			printf("Snapshot of %u particles at tick %llu written to '%s'\n",
+				_header.NumParticles, (unsigned long long)_header.Tick, _filePath.c_str());
+		}
+
+	public:
+		SnapshotWriter() = default;
+		~SnapshotWriter()
+		{
+			if (_fence != nullptr) glDeleteSync(_fence);
+			if (_stagingBuffer != 0) glDeleteBuffers(1, &_stagingBuffer);
+		}
+
+		SnapshotWriter(const SnapshotWriter&) = delete;
+		SnapshotWriter& operator= (const SnapshotWriter&) = delete;
+
+		bool IsPending() const { return _fence != nullptr; }
+
+		// starts a snapshot of the first `header.NumParticles` particles of
+		// `buffer`. The magic, version, and record size are filled in here.
+		// Returns false while the previous snapshot is still pending.
+		bool Capture(GLuint buffer, const SnapshotHeader& header, const std::string& filePath)
+		{
+			if (IsPending()) return false;
+
+			_header = header;
+			_header.Magic = SNAPSHOT_MAGIC;
+			_header.Version = SNAPSHOT_VERSION;
+			_header.RecordSize = sizeof(PackedWaveParticle);
+			_filePath = filePath;
+
+			const GLsizeiptr size = (GLsizeiptr)_header.NumParticles * sizeof(PackedWaveParticle);
+			if (_stagingBuffer == 0) glGenBuffers(1, &_stagingBuffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, _stagingBuffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, size > 0 ? size : 1, nullptr, GL_STREAM_READ);
+			if (size > 0)
+			{
+				glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+				glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			}
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			return true;
+		}
+
+		// writes the pending snapshot if its copy has finished, or, with
+		// `wait`, once it has. Call once per frame.
+		void Poll(bool wait = false)
+		{
+			if (_fence == nullptr) return;
+
+			const GLuint64 timeout = wait ? 1000000000ull : 0; // nanoseconds
+			GLenum status = glClientWaitSync(_fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+			if (status == GL_TIMEOUT_EXPIRED) return;
+
+			glDeleteSync(_fence);
+			_fence = nullptr;
+			if (status == GL_WAIT_FAILED)
+			{
+				fprintf(stderr, "---> ERROR: snapshot readback for '%s' failed!\n",
+					_filePath.c_str());
+				return;
+			}
+			write();
+		}
+	};
+
+	// a snapshot file, mapped into memory
+	class Snapshot
+	{
+	private:
+		Core::FileIO::FileView _file;
+		SnapshotHeader _header;
+		bool _isValid = false;
+
+	public:
+		explicit Snapshot(const std::string& filePath)
+			: _file(filePath)
+		{
+			if (!_file.IsOpen() || _file.GetSize() < sizeof(SnapshotHeader))
+			{
+				std::cerr << "Could not read snapshot '" << filePath << "'." << std::endl;
+				return;
+			}
+			memcpy(&_header, _file.GetData(), sizeof(_header));
+			_isValid = _header.Magic == SNAPSHOT_MAGIC &&
+				_header.Version == SNAPSHOT_VERSION &&
+				_header.RecordSize == sizeof(PackedWaveParticle) &&
+				_file.GetSize() >= sizeof(SnapshotHeader) + GetByteSize();
+			if (!_isValid)
+			{
+				fprintf(stderr, "---> ERROR: '%s' is not a valid snapshot!\n",
+					filePath.c_str());
+			}
+		}
+
+		bool IsValid() const { return _isValid; }
+		const SnapshotHeader& GetHeader() const { return _header; }
+
+		size_t GetByteSize() const
+		{
+			return (size_t)_header.NumParticles * sizeof(PackedWaveParticle);
+		}
+
+		// the particle records, inside the mapping
+		const void* GetParticles() const
+		{
+			return _file.GetData() + sizeof(SnapshotHeader);
+		}
+	};
+}
@@ -136,13 +136,15 @@ namespace Terrain
 			_mapSize = heightMap.GetSize();
 			_numVertices = _mapSize * _mapSize;
 			_vertices = new VertexData[_numVertices];
+
+			// the height plane is row-major, like the vertices
+			const GLfloat* heights = heightMap.GetHeights();
 			for (int row = 0; row < _mapSize; row++)
 			{
 				for (int col = 0; col < _mapSize; col++)
 				{
 					int index = row * _mapSize + col;
-					_vertices[index].Position =
-						glm::vec3(col, row, heightMap(col, row).Height);
+					_vertices[index].Position = glm::vec3(col, row, heights[index]);
 				}
 			}
 
@@ -251,7 +253,7 @@ namespace Terrain
 			glDeleteBuffers(1, &EBO);
 			glBindVertexArray(0);
 			glDeleteVertexArrays(1, &VAO);
-			delete _vertices;
+			delete[] _vertices;
 		}
 
 		void TestPrint() {
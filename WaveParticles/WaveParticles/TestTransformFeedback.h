@@ -10,7 +10,7 @@ using namespace Core;
 
 
 
-void TestTransformFeedback1()
+inline void TestTransformFeedback1()
 {
 	const GLchar* imageTFShaderOutputs[] = { "NewPosition" };
 	Shaders::ShaderWrapper imageTFShader("..|shaders|transformFeedback",
@@ -78,7 +78,7 @@ void TestTransformFeedback1()
 
 
 
-void TestTransformFeedback2()
+inline void TestTransformFeedback2()
 {
 	const GLchar* imageTFShaderOutputs[] = { "NewGeometryPosition" };
 	Shaders::ShaderWrapper imageTFShader("..|shaders|transformFeedback2",
@@ -148,7 +148,7 @@ void TestTransformFeedback2()
 
 
 
-void TestTransformFeedback3()
+inline void TestTransformFeedback3()
 {
 	const GLchar* imageTFShaderOutputs[] = { "NewPosition" };
 	Shaders::ShaderWrapper imageTFShader("..|shaders|transformFeedback3",
@@ -215,7 +215,7 @@ void TestTransformFeedback3()
 
 
 
-void TestTransformFeedbackVisualizePoint(Graphics::ApplicationWindow* window)
+inline void TestTransformFeedbackVisualizePoint(Graphics::ApplicationWindow* window)
 {
 	// visualizing shader
 	Shaders::ShaderWrapper visualizeShader("..|shaders|point", Shaders::SHADER_TYPE_VGF);
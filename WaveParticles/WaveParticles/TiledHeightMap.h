@@ -0,0 +1,313 @@
+///
+/// Tiled Height Map
+///
+/// On-disk height map format for maps too large to keep in memory, e.g.
+/// real coastline bathymetry. The file is memory-mapped, so the operating
+/// system pages tiles in when they are first read, and may drop them again
+/// under memory pressure. Only the region being simulated is copied into a
+/// Terrain::HeightMap (see LoadRegion).
+///
+/// File layout:
+///   - TiledHeightMapHeader
+///   - height plane: per tile (row-major over tiles), TileSize x TileSize
+///     quantized uint16 heights, row-major inside the tile
+///   - type plane: per tile, TileSize x TileSize 2-bit field types,
+///     four fields per byte, lowest bits first
+///
+/// Tiles on the right and bottom edges are padded to the full tile size.
+/// Files are written by WriteTiledHeightMap or ConvertRawToTiledHeightMap.
+///
+
+#pragma once
+
+// STANDARD
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+// CUSTOM
+#include "HeightMap.h"
+#include "HeightMapLoader.h"
+#include "FileIO.h"
+
+
+namespace Terrain
+{
+	struct TiledHeightMapHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Width;      // in fields
+		uint32_t Height;     // in fields
+		uint32_t TileSize;   // fields per tile side, a multiple of 4
+		uint32_t NumTilesX;
+		uint32_t NumTilesY;
+		float MinHeight;     // height of quantized value 0
+		float MaxHeight;     // height of quantized value 0xFFFF
+		uint32_t _padding;
+		uint64_t HeightPlaneOffset;
+		uint64_t TypePlaneOffset;
+	};
+
+	static constexpr uint32_t TILED_HEIGHT_MAP_MAGIC = 0x48545057; // "WPTH"
+	static constexpr uint32_t TILED_HEIGHT_MAP_VERSION = 1;
+	static constexpr uint32_t DEFAULT_HEIGHT_MAP_TILE_SIZE = 256;
+
+	// a single tile, pointing into the mapped file
+	struct HeightMapTile
+	{
+		const uint16_t* Heights;
+		const uint8_t* Types;
+		uint32_t Size;
+		float MinHeight;
+		float Scale; // height per quantization step
+
+		GLfloat GetHeight(uint32_t x, uint32_t y) const
+		{
+			return MinHeight + Scale * Heights[y * Size + x];
+		}
+
+		HeightMapFieldType GetType(uint32_t x, uint32_t y) const
+		{
+			uint32_t index = y * Size + x;
+			return (HeightMapFieldType)((Types[index >> 2] >> ((index & 3) * 2)) & 0x3);
+		}
+	};
+
+	class TiledHeightMap
+	{
+	private:
+		Core::FileIO::FileView _file;
+		TiledHeightMapHeader _header = {};
+		bool _isValid = false;
+
+		size_t GetTileHeightBytes() const
+		{
+			return (size_t)_header.TileSize * _header.TileSize * sizeof(uint16_t);
+		}
+
+		size_t GetTileTypeBytes() const
+		{
+			return (size_t)_header.TileSize * _header.TileSize / 4;
+		}
+
+	public:
+		TiledHeightMap(const std::string& filePath)
+			: _file(filePath)
+		{
+			if (!_file.IsOpen() || _file.GetSize() < sizeof(TiledHeightMapHeader))
+			{
+				std::cerr << "Could not read tiled height map '" << filePath << "'." << std::endl;
+				return;
+			}
+
+			memcpy(&_header, _file.GetData(), sizeof(_header));
+			const size_t numTiles = (size_t)_header.NumTilesX * _header.NumTilesY;
+			_isValid = _header.Magic == TILED_HEIGHT_MAP_MAGIC &&
+				_header.Version == TILED_HEIGHT_MAP_VERSION &&
+				_header.TileSize > 0 && _header.TileSize % 4 == 0 &&
+				_header.HeightPlaneOffset + numTiles * GetTileHeightBytes() <= _file.GetSize() &&
+				_header.TypePlaneOffset + numTiles * GetTileTypeBytes() <= _file.GetSize();
+
+			if (!_isValid)
+			{
+				fprintf(stderr, "---> ERROR: '%s' is not a valid tiled height map!\n",
+					filePath.c_str());
+			}
+		}
+
+		bool IsValid() const { return _isValid; }
+		uint32_t GetWidth() const { return _header.Width; }
+		uint32_t GetHeight() const { return _header.Height; }
+		uint32_t GetTileSize() const { return _header.TileSize; }
+		uint32_t GetNumTilesX() const { return _header.NumTilesX; }
+		uint32_t GetNumTilesY() const { return _header.NumTilesY; }
+
+		HeightMapTile GetTile(uint32_t tileX, uint32_t tileY) const
+		{
+			assert(tileX < _header.NumTilesX);
+			assert(tileY < _header.NumTilesY);
+			const size_t tileIndex = (size_t)tileY * _header.NumTilesX + tileX;
+
+			HeightMapTile tile;
+			tile.Heights = (const uint16_t*)(_file.GetData() +
+				_header.HeightPlaneOffset + tileIndex * GetTileHeightBytes());
+			tile.Types = (const uint8_t*)(_file.GetData() +
+				_header.TypePlaneOffset + tileIndex * GetTileTypeBytes());
+			tile.Size = _header.TileSize;
+			tile.MinHeight = _header.MinHeight;
+			tile.Scale = (_header.MaxHeight - _header.MinHeight) / 65535.0f;
+			return tile;
+		}
+
+		GLfloat GetFieldHeight(uint32_t x, uint32_t y) const
+		{
+			const uint32_t size = _header.TileSize;
+			return GetTile(x / size, y / size).GetHeight(x % size, y % size);
+		}
+
+		HeightMapFieldType GetFieldType(uint32_t x, uint32_t y) const
+		{
+			const uint32_t size = _header.TileSize;
+			return GetTile(x / size, y / size).GetType(x % size, y % size);
+		}
+
+		// copies the `size` x `size` region starting at (`originX`, `originY`)
+		// into a new in-memory height map. Fields outside the map are land.
+		HeightMap* LoadRegion(uint32_t originX, uint32_t originY, uint32_t size) const
+		{
+			HeightMap* heightMap = new HeightMap(size);
+			const uint32_t tileSize = _header.TileSize;
+
+			// tile by tile, such that each tile is paged in only once
+			const uint32_t endX = std::min(originX + size, _header.Width);
+			const uint32_t endY = std::min(originY + size, _header.Height);
+			for (uint32_t y = 0; y < size; y++)
+			{
+				for (uint32_t x = 0; x < size; x++)
+				{
+					heightMap->SetHeight(x, y, _header.MaxHeight);
+					heightMap->SetType(x, y, HEIGHT_FIELD_TYPE_LAND);
+				}
+			}
+			for (uint32_t tileY = originY / tileSize; tileY * tileSize < endY; tileY++)
+			{
+				for (uint32_t tileX = originX / tileSize; tileX * tileSize < endX; tileX++)
+				{
+					const HeightMapTile tile = GetTile(tileX, tileY);
+					const uint32_t y0 = std::max(originY, tileY * tileSize);
+					const uint32_t y1 = std::min(endY, (tileY + 1) * tileSize);
+					const uint32_t x0 = std::max(originX, tileX * tileSize);
+					const uint32_t x1 = std::min(endX, (tileX + 1) * tileSize);
+					for (uint32_t y = y0; y < y1; y++)
+					{
+						for (uint32_t x = x0; x < x1; x++)
+						{
+							const uint32_t tx = x - tileX * tileSize;
+							const uint32_t ty = y - tileY * tileSize;
+							heightMap->SetHeight(x - originX, y - originY, tile.GetHeight(tx, ty));
+							heightMap->SetType(x - originX, y - originY, tile.GetType(tx, ty));
+						}
+					}
+				}
+			}
+			return heightMap;
+		}
+	};
+
+
+	// writes a tiled height map of `width` x `height` fields, where
+	// `getField(x, y, quantizedHeight, type)` provides every field. The source
+	// is read one tile at a time, twice (once per plane).
+	template<typename FieldSource>
+	bool writeTiledHeightMap(const std::string& filePath, uint32_t width, uint32_t height,
+		uint32_t tileSize, float minHeight, float maxHeight, FieldSource getField)
+	{
+		tileSize = std::max(4u, (tileSize + 3) / 4 * 4);
+
+		TiledHeightMapHeader header = {};
+		header.Magic = TILED_HEIGHT_MAP_MAGIC;
+		header.Version = TILED_HEIGHT_MAP_VERSION;
+		header.Width = width;
+		header.Height = height;
+		header.TileSize = tileSize;
+		header.NumTilesX = (width + tileSize - 1) / tileSize;
+		header.NumTilesY = (height + tileSize - 1) / tileSize;
+		header.MinHeight = minHeight;
+		header.MaxHeight = maxHeight;
+
+		const size_t numTiles = (size_t)header.NumTilesX * header.NumTilesY;
+		const size_t tileFields = (size_t)tileSize * tileSize;
+		header.HeightPlaneOffset = sizeof(TiledHeightMapHeader);
+		header.TypePlaneOffset = header.HeightPlaneOffset + numTiles * tileFields * sizeof(uint16_t);
+
+		std::ofstream file(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Could not write tiled height map '" << filePath << "'." << std::endl;
+			return false;
+		}
+		file.write((const char*)&header, sizeof(header));
+
+		std::vector<uint16_t> heights(tileFields);
+		std::vector<uint8_t> types(tileFields / 4);
+		for (int plane = 0; plane < 2; plane++)
+		{
+			for (uint32_t tileY = 0; tileY < header.NumTilesY; tileY++)
+			{
+				for (uint32_t tileX = 0; tileX < header.NumTilesX; tileX++)
+				{
+					std::fill(heights.begin(), heights.end(), (uint16_t)0xFFFF);
+					std::fill(types.begin(), types.end(), (uint8_t)0xAA); // all land (2)
+					for (uint32_t y = 0; y < tileSize; y++)
+					{
+						for (uint32_t x = 0; x < tileSize; x++)
+						{
+							const uint32_t fieldX = tileX * tileSize + x;
+							const uint32_t fieldY = tileY * tileSize + y;
+							if (fieldX >= width || fieldY >= height) continue;
+
+							uint16_t quantized;
+							HeightMapFieldType type;
+							getField(fieldX, fieldY, quantized, type);
+
+							const uint32_t index = y * tileSize + x;
+							heights[index] = quantized;
+							uint8_t& packed = types[index >> 2];
+							const int shift = (index & 3) * 2;
+							packed = (uint8_t)((packed & ~(0x3 << shift)) | ((type & 0x3) << shift));
+						}
+					}
+					if (plane == 0) file.write((const char*)heights.data(), heights.size() * sizeof(uint16_t));
+					else file.write((const char*)types.data(), types.size());
+				}
+			}
+		}
+		return (bool)file;
+	}
+
+	// writes an in-memory height map in the tiled format
+	inline bool WriteTiledHeightMap(const std::string& filePath, const HeightMap& heightMap,
+		float minHeight, float maxHeight, uint32_t tileSize = DEFAULT_HEIGHT_MAP_TILE_SIZE)
+	{
+		const float scale = 65535.0f / std::max(maxHeight - minHeight, 1e-6f);
+		return writeTiledHeightMap(filePath, heightMap.GetSize(), heightMap.GetSize(),
+			tileSize, minHeight, maxHeight,
+			[&](uint32_t x, uint32_t y, uint16_t& quantized, HeightMapFieldType& type)
+			{
+				float value = std::round((heightMap.GetHeight(x, y) - minHeight) * scale);
+				quantized = (uint16_t)std::clamp(value, 0.0f, 65535.0f);
+				type = heightMap.GetType(x, y);
+			});
+	}
+
+	// converts a RAW 16-bit height map of `width` x `height` samples, without
+	// loading it into memory, and classifies the fields (see ClassifyHeight)
+	inline bool ConvertRawToTiledHeightMap(const std::string& rawPath, uint32_t width, uint32_t height,
+		float minHeight, float maxHeight, float seaLevel, float shallowDepth,
+		const std::string& tiledPath, uint32_t tileSize = DEFAULT_HEIGHT_MAP_TILE_SIZE,
+		bool bigEndian = false)
+	{
+		Core::FileIO::FileView raw(rawPath);
+		if (!raw.IsOpen() || raw.GetSize() < (size_t)width * height * 2)
+		{
+			fprintf(stderr, "---> ERROR: '%s' is not a %ux%u RAW height map!\n",
+				rawPath.c_str(), width, height);
+			return false;
+		}
+
+		const unsigned char* samples = (const unsigned char*)raw.GetData();
+		const float scale = (maxHeight - minHeight) / 65535.0f;
+		return writeTiledHeightMap(tiledPath, width, height, tileSize, minHeight, maxHeight,
+			[&](uint32_t x, uint32_t y, uint16_t& quantized, HeightMapFieldType& type)
+			{
+				quantized = readSample16(samples, (size_t)y * width + x, bigEndian);
+				type = ClassifyHeight(minHeight + scale * quantized, seaLevel, shallowDepth);
+			});
+	}
+}
@@ -0,0 +1,249 @@
+///
+/// Tiled World
+///
+/// A large body of water, decomposed into a grid of tiles. Each tile is a
+/// World of its own, with its own particle buffers and distribution
+/// texture, covering [-1,1]² in its own coordinates. The borders between
+/// tiles are open: a particle crossing one is captured by the tile it
+/// leaves (see World::GetOutgoingParticles), and handed over to the
+/// neighbour through a compact transfer list, which emits it at its next
+/// step. The transfer list is read back without waiting for the GPU, so
+/// the hand-over trails the crossing by a tick or two; particles move
+/// analytically from their origin, so they reappear where they belong.
+/// Only the outer borders of the grid reflect.
+///
+/// Tiled-world coordinates span [-NumTilesX, NumTilesX] x [-NumTilesY,
+/// NumTilesY], such that a 1 x 1 grid is an ordinary world. Tile (0, 0) is
+/// at the lower left.
+///
+/// All tiles due in a step run in a single World::StepAll, so each pass
+/// binds its program once for the whole grid, and all tiles step to the
+/// same time. Tiles without any particles are not stepped at all. With
+/// SetFocus, tiles away from the camera are stepped only every few ticks,
+/// in larger steps.
+///
+/// Particles splat only into the tile they are in, so the height of a
+/// particle within its radius of a border is missing in the neighbour.
+/// Tiles propagate on the GPU; the event-driven propagation reflects at
+/// every border.
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// CUSTOM
+#include "World.h"
+#include "TiledHeightMap.h"
+
+
+namespace Simulation
+{
+	class TiledWorld
+	{
+	private:
+		int _numTilesX;
+		int _numTilesY;
+		std::vector<World*> _tiles;       // row-major, from the lower left
+		std::vector<bool> _hasStepped;    // the texture of a new tile is undefined
+		SimulationClock _clock;
+
+		// see SetFocus
+		bool _hasFocus = false;
+		glm::vec2 _focus = glm::vec2(0.0f);
+		GLfloat _focusRadius = 0.0f;
+		uint32_t _farInterval = 1;
+
+		// scratch space of Step
+		std::vector<World*> _due;
+		std::vector<size_t> _dueIndices;
+		size_t _numMigrated = 0;
+
+		World* getTile(int x, int y) const
+		{
+			if (x < 0 || y < 0 || x >= _numTilesX || y >= _numTilesY) return nullptr;
+			return _tiles[(size_t)y * _numTilesX + x];
+		}
+
+		// distance of `position` to the area of tile (`x`, `y`)
+		GLfloat distanceToTile(glm::vec2 position, int x, int y) const
+		{
+			const glm::vec2 offset = glm::abs(position - GetTileCentre(x, y)) - glm::vec2(1.0f);
+			return glm::length(glm::max(offset, glm::vec2(0.0f)));
+		}
+
+		bool isDue(int x, int y) const
+		{
+			const size_t index = (size_t)y * _numTilesX + x;
+			if (!_hasStepped[index]) return true;
+			if (_tiles[index]->IsIdle()) return false;
+			if (!_hasFocus || distanceToTile(_focus, x, y) <= _focusRadius) return true;
+
+			// spread over the ticks, such that not all far tiles step together
+			return (_clock.GetTick() + index) % _farInterval == 0;
+		}
+
+		// hands the particles that left tile `index` over to its neighbours
+		void migrate(size_t index)
+		{
+			const int x = (int)(index % _numTilesX);
+			const int y = (int)(index / _numTilesX);
+			for (PackedWaveParticle particle : _tiles[index]->GetOutgoingParticles())
+			{
+				int dx = (particle.paramVec1.x > 1.0f) ? 1 : (particle.paramVec1.x < -1.0f) ? -1 : 0;
+				int dy = (particle.paramVec1.y > 1.0f) ? 1 : (particle.paramVec1.y < -1.0f) ? -1 : 0;
+
+				// beyond a closed border, e.g. at a corner with the edge of the
+				// grid, the particle was reflected, but is still outside. It
+				// stays on this side, and goes to the edge neighbour only.
+				if (getTile(x + dx, y) == nullptr) dx = 0;
+				if (getTile(x, y + dy) == nullptr) dy = 0;
+				World* neighbour = getTile(x + dx, y + dy);
+				if (neighbour == nullptr || (dx == 0 && dy == 0)) continue;
+				if (dx == 0) particle.paramVec1.x = glm::clamp(particle.paramVec1.x, -1.0f, 1.0f);
+				if (dy == 0) particle.paramVec1.y = glm::clamp(particle.paramVec1.y, -1.0f, 1.0f);
+
+				// position and origin into the coordinates of the neighbour
+				const glm::vec2 shift(2.0f * dx, 2.0f * dy);
+				particle.paramVec1.x -= shift.x;
+				particle.paramVec1.y -= shift.y;
+				particle.paramVec2.x -= shift.x;
+				particle.paramVec2.y -= shift.y;
+				neighbour->Emit(particle);
+				_numMigrated++;
+			}
+		}
+
+	public:
+		// `settings` apply to each tile, e.g. TextureSize is per tile. The
+		// particle buffers grow on demand, so a small InitialParticleCapacity
+		// keeps quiet tiles cheap. With `terrain`, each tile loads the
+		// TextureSize x TextureSize fields it covers, see LoadRegion.
+		TiledWorld(WorldPrograms& programs, const WorldSettings& settings, int numTilesX,
+			int numTilesY, const Terrain::TiledHeightMap* terrain = nullptr)
+			: _numTilesX(std::max(numTilesX, 1)),
+			_numTilesY(std::max(numTilesY, 1)),
+			_clock((settings.TimeStep > 0.0) ? SimulationClock(settings.TimeStep) : SimulationClock())
+		{
+			const uint32_t size = (uint32_t)settings.TextureSize;
+			for (int y = 0; y < _numTilesY; y++)
+			{
+				for (int x = 0; x < _numTilesX; x++)
+				{
+					WorldSettings tileSettings = settings;
+					tileSettings.Seed = settings.Seed + (uint32_t)_tiles.size();
+					Terrain::HeightMap* tileTerrain = (terrain != nullptr) ?
+						terrain->LoadRegion((uint32_t)x * size, (uint32_t)y * size, size) : nullptr;
+
+					World* tile = new World(programs, tileSettings, tileTerrain);
+					tile->SetOpenBorders(x > 0, x < _numTilesX - 1, y > 0, y < _numTilesY - 1);
+					_tiles.push_back(tile);
+				}
+			}
+			_hasStepped.assign(_tiles.size(), false);
+		}
+
+		~TiledWorld()
+		{
+			for (World* tile : _tiles) delete tile;
+		}
+
+		TiledWorld(const TiledWorld&) = delete;
+		TiledWorld& operator= (const TiledWorld&) = delete;
+
+		// tiles overlapping the circle around `focus` (e.g. the camera) step
+		// every tick, the others with particles every `farInterval` ticks.
+		// A particle should not cross a whole tile within `farInterval` ticks.
+		void SetFocus(glm::vec2 focus, GLfloat radius, uint32_t farInterval)
+		{
+			_hasFocus = true;
+			_focus = focus;
+			_focusRadius = radius;
+			_farInterval = std::max(farInterval, 1u);
+		}
+
+		// adds `particle`, in tiled-world coordinates, at the next step. Its
+		// TimeAtOrigin is on the clock of the tiled world, see GetClock.
+		void Emit(PackedWaveParticle particle)
+		{
+			int x, y;
+			GetTileAt(glm::vec2(particle.paramVec1), x, y);
+			const glm::vec2 centre = GetTileCentre(x, y);
+			particle.paramVec1.x -= centre.x;
+			particle.paramVec1.y -= centre.y;
+			particle.paramVec2.x -= centre.x;
+			particle.paramVec2.y -= centre.y;
+			getTile(x, y)->Emit(particle);
+		}
+
+		// one tick of every due tile, followed by the hand-over of the
+		// particles that crossed a border. Returns the number of tiles stepped.
+		size_t Step()
+		{
+			_clock.Tick();
+
+			_due.clear();
+			_dueIndices.clear();
+			for (int y = 0; y < _numTilesY; y++)
+			{
+				for (int x = 0; x < _numTilesX; x++)
+				{
+					if (!isDue(x, y)) continue;
+					_due.push_back(getTile(x, y));
+					_dueIndices.push_back((size_t)y * _numTilesX + x);
+				}
+			}
+			World::StepAll(_due.data(), _due.size(), &_clock);
+
+			// only the tiles just stepped have outgoing particles
+			_numMigrated = 0;
+			for (size_t index : _dueIndices)
+			{
+				_hasStepped[index] = true;
+				migrate(index);
+			}
+			return _due.size();
+		}
+
+		// the tile containing `position`, in tiled-world coordinates. Positions
+		// outside the grid give the nearest tile.
+		void GetTileAt(glm::vec2 position, int& x, int& y) const
+		{
+			x = std::clamp((int)std::floor((position.x + _numTilesX) * 0.5f), 0, _numTilesX - 1);
+			y = std::clamp((int)std::floor((position.y + _numTilesY) * 0.5f), 0, _numTilesY - 1);
+		}
+
+		// the origin of tile (`x`, `y`), in tiled-world coordinates
+		glm::vec2 GetTileCentre(int x, int y) const
+		{
+			return glm::vec2(2 * x + 1 - _numTilesX, 2 * y + 1 - _numTilesY);
+		}
+
+		World& GetTile(int x, int y) { return *getTile(x, y); }
+		int GetNumTilesX() const { return _numTilesX; }
+		int GetNumTilesY() const { return _numTilesY; }
+
+		// applied to every tile at its next step
+		void SetParameters(const SimulationParameters& parameters)
+		{
+			for (World* tile : _tiles) tile->SetParameters(parameters);
+		}
+
+		// summed over all tiles
+		size_t GetNumParticles() const
+		{
+			size_t count = 0;
+			for (const World* tile : _tiles) count += tile->GetNumParticles();
+			return count;
+		}
+
+		// particles handed over to a neighbour during the last step
+		size_t GetNumMigrated() const { return _numMigrated; }
+
+		const SimulationClock& GetClock() const { return _clock; }
+	};
+}
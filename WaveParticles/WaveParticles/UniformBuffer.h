@@ -0,0 +1,72 @@
+///
+/// Uniform Buffer
+///
+/// A uniform buffer object (UBO) holding a single struct `T`, which must
+/// follow the std140 layout rules of the matching GLSL uniform block.
+/// The buffer is attached to a fixed binding point, and every shader
+/// program that declares the block reads from it, such that shared values
+/// are uploaded once rather than once per program.
+///
+
+#pragma once
+
+// CUSTOM
+#include "OpenGL.h"
+
+
+namespace Core::Shaders
+{
+	template<class T>
+	class UniformBuffer
+	{
+	private:
+		GLuint _buffer;
+		GLuint _binding;
+
+	public:
+		UniformBuffer(GLuint binding)
+			: _binding(binding)
+		{
+			// std140 sizes are always a multiple of 16 bytes (a vec4)
+			static_assert(sizeof(T) % 16 == 0, "std140 struct size must be a multiple of 16");
+
+			glGenBuffers(1, &_buffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+			glBindBufferBase(GL_UNIFORM_BUFFER, _binding, _buffer);
+		}
+		~UniformBuffer()
+		{
+			glDeleteBuffers(1, &_buffer);
+		}
+
+		UniformBuffer(const UniformBuffer&) = delete;
+		UniformBuffer& operator= (const UniformBuffer&) = delete;
+
+		// upload the whole struct
+		void Update(const T& data)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, _buffer);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+
+		// re-attach to the binding point, if it has been used by something else
+		void Bind() const
+		{
+			glBindBufferBase(GL_UNIFORM_BUFFER, _binding, _buffer);
+		}
+
+		GLuint GetBinding() const
+		{
+			return _binding;
+		}
+
+		GLuint GetBuffer() const
+		{
+			return _buffer;
+		}
+	};
+}
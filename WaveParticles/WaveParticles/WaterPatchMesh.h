@@ -0,0 +1,138 @@
+///
+/// Water Patch Mesh
+///
+/// Coarse grid of quad patches covering the same area as WaterMesh,
+/// intended to be refined on the GPU by the tessellation stages of the
+/// 'waterSurfaceTessellated' shader program. Each patch consists of
+/// 4 control points, ordered counter-clockwise:
+///
+/// 3 ----- 2
+/// |       |
+/// |       |   (one patch, 'patchSize' grid cells wide)
+/// |       |
+/// 0 ----- 1
+///
+/// Requires OpenGL 4.0 (see OpenGL::IsTessellationSupported).
+///
+
+#pragma once
+
+// CUSTOM
+#include "OpenGL.h"
+
+// STANDARD
+#include <vector>
+
+
+namespace Terrain
+{
+	class WaterPatchMesh
+	{
+	private:
+		// map properties
+		int _mapSize;
+		int _patchSize;
+		int _patchesPerSide;
+
+		// buffer objects
+		GLuint VAO, VBO, EBO;
+
+		// control points, (x,y) = gridpoint, z = 0
+		std::vector<glm::vec3> _controlPoints;
+
+		// 4 indices per patch
+		std::vector<GLuint> _indices;
+
+		void _buffer_data() {
+			glGenVertexArrays(1, &VAO);
+			glGenBuffers(1, &VBO);
+			glGenBuffers(1, &EBO);
+
+			glBindVertexArray(VAO);
+
+			glBindBuffer(GL_ARRAY_BUFFER, VBO);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _controlPoints.size(),
+				_controlPoints.data(), GL_STATIC_DRAW);
+
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * _indices.size(),
+				_indices.data(), GL_STATIC_DRAW);
+
+			// grid point data, same layout as WaterMesh
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+				(GLvoid*)0);
+			glEnableVertexAttribArray(0);
+
+			glBindVertexArray(0);
+		}
+
+	public:
+		// `size` is the number of grid points per side (as for WaterMesh),
+		// `patchSize` is the number of grid cells per patch side
+		WaterPatchMesh(int size, int patchSize)
+		{
+			_mapSize = size;
+			_patchSize = patchSize;
+
+			// the last patch row/column is clamped to the map border
+			_patchesPerSide = (_mapSize - 2) / _patchSize + 1;
+			const int pointsPerSide = _patchesPerSide + 1;
+
+			for (int row = 0; row < pointsPerSide; row++)
+			{
+				for (int col = 0; col < pointsPerSide; col++)
+				{
+					GLfloat x = (GLfloat)glm::min(col * _patchSize, _mapSize - 1);
+					GLfloat y = (GLfloat)glm::min(row * _patchSize, _mapSize - 1);
+					_controlPoints.push_back(glm::vec3(x, y, 0.0f));
+				}
+			}
+
+			for (int row = 0; row < _patchesPerSide; row++)
+			{
+				for (int col = 0; col < _patchesPerSide; col++)
+				{
+					GLuint index = row * pointsPerSide + col;
+					_indices.push_back(index);                     // lower-left
+					_indices.push_back(index + 1);                 // lower-right
+					_indices.push_back(index + pointsPerSide + 1); // upper-right
+					_indices.push_back(index + pointsPerSide);     // upper-left
+				}
+			}
+
+			_buffer_data();
+		}
+		~WaterPatchMesh()
+		{
+			// to prevent GPU memory leaks!
+			glBindVertexArray(VAO);
+			glDeleteBuffers(1, &VBO);
+			glDeleteBuffers(1, &EBO);
+			glBindVertexArray(0);
+			glDeleteVertexArrays(1, &VAO);
+		}
+
+		void Render() const
+		{
+			glPatchParameteri(GL_PATCH_VERTICES, 4);
+			glBindVertexArray(VAO);
+			glDrawElements(GL_PATCHES, (GLsizei)_indices.size(), GL_UNSIGNED_INT, 0);
+			glBindVertexArray(0);
+		}
+
+		int GetMapSize() const
+		{
+			return _mapSize;
+		}
+
+		int GetPatchSize() const
+		{
+			return _patchSize;
+		}
+
+		int GetNumPatches() const
+		{
+			return _patchesPerSide * _patchesPerSide;
+		}
+	};
+}
@@ -6,6 +6,8 @@
 
 // STANDARD
 #include <iostream>
+#include <cstring>
+#include <vector>
 
 // CUSTOM
 #include "ApplicationWindow.h"
@@ -14,13 +16,26 @@
 #include "MainTimer.h"
 #include "FileIO.h"
 #include "ShaderWrapper.h"
+#include "ShaderManager.h"
 #include "Image.h"
 #include "TestTransformFeedback.h"
 #include "Particle.h"
 #include "RandomGenerator.h"
 #include "HeightMap.h"
+#include "HeightMapLoader.h"
+#include "HeightMapTexture.h"
 #include "TerrainMesh.h"
 #include "WaterMesh.h"
+#include "WaterPatchMesh.h"
+#include "UniformBuffer.h"
+#include "SimulationUniforms.h"
+#include "World.h"
+#include "WorldScheduler.h"
+#include "TiledWorld.h"
+#include "Hash.h"
+#include "InputLog.h"
+#include "Snapshot.h"
+#include "HeightFieldExport.h"
 
 using namespace Core;
 using namespace Utilities;
@@ -32,10 +47,38 @@ Graphics::BasicRTSCamera* cam;
 bool keyboard[1024];
 GLint waterSurfacePolygonMode = GL_LINE;
 bool spawnNewParticle = false;
+bool tessellateWaterSurface = false;
+bool reloadShaders = false;
+
+// THE SIMULATION, see World.h. Input goes to the first world.
+Simulation::World* world = nullptr;
+
+// INPUT LOG, see InputLog.h
+Simulation::InputRecorder* inputRecorder = nullptr;
+bool replayingInput = false;
+
+// SNAPSHOT, see Snapshot.h. 'F5' saves, 'F9' restores.
+std::string snapshotFile = "snapshot.wps";
+bool saveSnapshot = false;
+bool loadSnapshot = false;
+
+// HEIGHT QUERY, 'H' samples a grid of heights (see HeightQuery.h)
+bool queryHeights = false;
 
 void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
 	static bool wireframe = false;
+	Simulation::SimulationParameters parameters = world->GetParameters();
+
+	// replayed events arrive without a window. While replaying, the log is
+	// the only input, except for leaving early.
+	if (window != nullptr && key != GLFW_KEY_ESCAPE && key >= 0) {
+		if (replayingInput) return;
+		if (inputRecorder != nullptr && action != GLFW_REPEAT) {
+			inputRecorder->Record(key, action);
+		}
+	}
+
 	if (action == GLFW_PRESS) {
 		switch (key)
 		{
@@ -55,10 +98,46 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mode
 			spawnNewParticle = true;
 			break;
 		case GLFW_KEY_1:
-			PackedWaveParticle::TogglePropagate();
+			world->SetPropagate(!world->IsPropagating());
 			break;
 		case GLFW_KEY_2:
-			PackedWaveParticle::ToggleCreateRemote();
+			world->SetCreateRemote(!world->IsCreatingRemote());
+			break;
+		case GLFW_KEY_T:
+			tessellateWaterSurface = !tessellateWaterSurface;
+			break;
+		case GLFW_KEY_R:
+			reloadShaders = true;
+			break;
+		case GLFW_KEY_C:
+			world->SetCpuPropagation(!world->IsCpuPropagation());
+			std::cout << "Propagation on the " << (world->IsCpuPropagation() ?
+				"CPU (event-driven)" : "GPU (transform feedback)") << std::endl;
+			break;
+		case GLFW_KEY_L:
+			parameters.terrainReflection = (parameters.terrainReflection > 0.0f) ? 0.0f : 1.0f;
+			world->SetParameters(parameters);
+			std::cout << "Shore " << (parameters.terrainReflection > 0.0f ?
+				"reflects" : "absorbs") << " wave particles" << std::endl;
+			break;
+		case GLFW_KEY_LEFT_BRACKET:
+			parameters.dampingCoefficient *= 0.5f;
+			world->SetParameters(parameters);
+			std::cout << "Damping coefficient: " << parameters.dampingCoefficient << std::endl;
+			break;
+		case GLFW_KEY_H:
+			queryHeights = true;
+			break;
+		case GLFW_KEY_F5:
+			saveSnapshot = true;
+			break;
+		case GLFW_KEY_F9:
+			loadSnapshot = true;
+			break;
+		case GLFW_KEY_RIGHT_BRACKET:
+			parameters.dampingCoefficient *= 2.0f;
+			world->SetParameters(parameters);
+			std::cout << "Damping coefficient: " << parameters.dampingCoefficient << std::endl;
 			break;
 
 		default:
@@ -119,12 +198,114 @@ bool MoveCamera(GLfloat deltaTime)
 	return retval;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// COMMAND LINE
+	//   --map <file>   terrain height map (.raw, .r16, or .pgm), see HeightMapLoader.h
+	//   --deterministic [seed]
+	//                  fixed random seed, and a simulated clock advancing by
+	//                  exactly one step per frame, see SimulationClock.h
+	//   --record <file>
+	//                  deterministic, and writes all key input to an input log
+	//   --replay <file>
+	//                  deterministic with the seed of the log, replays its key
+	//                  input as fast as possible, and quits at its last tick
+	//   --hidden       does not show the window, e.g. for load tests
+	//   --worlds <n>   simulates n - 1 more worlds of open ocean next to the
+	//                  rendered one, e.g. for load tests, see WorldScheduler.h
+	//   --tiles <n>    simulates an n x n tiled ocean next to the rendered
+	//                  world, e.g. for load tests, see TiledWorld.h
+	//   --snapshot <file>
+	//                  starts from a snapshot, which is also the file 'F5'
+	//                  saves to and 'F9' restores from
+	//   --export-heights <file> [interval]
+	//                  streams the height field to a file every `interval`
+	//                  ticks (default 1), see HeightFieldExport.h
+	const char* heightMapFile = nullptr;
+	const char* recordFile = nullptr;
+	const char* replayFile = nullptr;
+	const char* exportFile = nullptr;
+	uint64_t exportInterval = 1;
+	bool deterministic = false;
+	bool hidden = false;
+	uint32_t deterministicSeed = 1;
+	int numWorlds = 1;
+	int numTiles = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--map") == 0 && i + 1 < argc)
+		{
+			heightMapFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--deterministic") == 0)
+		{
+			deterministic = true;
+			if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+			{
+				deterministicSeed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+			}
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			recordFile = argv[++i];
+			deterministic = true;
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replayFile = argv[++i];
+			deterministic = true;
+		}
+		else if (strcmp(argv[i], "--hidden") == 0)
+		{
+			hidden = true;
+		}
+		else if (strcmp(argv[i], "--worlds") == 0 && i + 1 < argc)
+		{
+			numWorlds = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc)
+		{
+			numTiles = std::max(atoi(argv[++i]), 1);
+		}
+		else if (strcmp(argv[i], "--export-heights") == 0 && i + 1 < argc)
+		{
+			exportFile = argv[++i];
+			if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+			{
+				exportInterval = std::max(strtoull(argv[++i], nullptr, 10), 1ull);
+			}
+		}
+		else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc)
+		{
+			snapshotFile = argv[++i];
+			loadSnapshot = true;
+		}
+	}
+	Simulation::InputReplayer* inputReplayer = nullptr;
+	if (replayFile != nullptr)
+	{
+		inputReplayer = new Simulation::InputReplayer(replayFile);
+		if (!inputReplayer->IsValid())
+		{
+			delete inputReplayer;
+			return -1;
+		}
+		deterministicSeed = inputReplayer->GetHeader().Seed;
+		replayingInput = true;
+		std::cout << "Replaying " << inputReplayer->GetHeader().NumEvents
+			<< " input events over " << inputReplayer->GetHeader().EndTick
+			<< " ticks from '" << replayFile << "'" << std::endl;
+	}
+	if (deterministic)
+	{
+		std::cout << "Deterministic mode, seed " << deterministicSeed << std::endl;
+	}
+
 	// WINDOW SETUP
 	win = new Graphics::ApplicationWindow();
 	Graphics::AspectRatio aspect(800, Graphics::ASPECT_RATIO_1_1);
 	win->SetTitle("Wave Particles");
+	win->SetVisible(!hidden);
 	win->SetWindowed(aspect);
 	win->SetKeyCallback(KeyCallback);
 	win->SetClearFlags(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -145,240 +326,301 @@ int main()
 	cam = new Graphics::BasicRTSCamera(aspect.GetWidth(), aspect.GetHeight(),
 		camPos, camFront, camUp);
 
-	// TIMER
-	Utilities::MainTimer timer(60, 30);
-	GLfloat lastTime = glfwGetTime();
-	GLfloat nowTime;
-	GLfloat deltaTime;
+	// SHADER PROGRAMS
+
+	// every program is submitted here, before any of them is used, such that
+	// the driver can compile them in parallel (see ShaderManager). The
+	// simulation programs are shared by all worlds (see World.h).
+	Simulation::WorldSettings worldSettings;
+	Simulation::WorldPrograms worldPrograms(worldSettings.ShaderRoot,
+		worldSettings.MaxSubdivisionBranches);
+	Shaders::ShaderManager shaderManager;
 
+	Shaders::ShaderWrapper& waterSurfaceMeshShader = shaderManager.Submit(
+		"..|shaders|waveParticles|waterSurface", Shaders::SHADER_TYPE_VF);
 
+	const bool isTessellationSupported = OpenGL::IsTessellationSupported();
+	Shaders::ShaderWrapper* waterSurfacePatchShader = nullptr;
+	if (isTessellationSupported)
+	{
+		waterSurfacePatchShader = &shaderManager.Submit(
+			"..|shaders|waveParticles|waterSurfaceTessellated", Shaders::SHADER_TYPE_VTF);
+	}
 
+	// state shared by all programs is uploaded once into uniform buffers
+	shaderManager.BindUniformBlock("FrameUniforms", Simulation::FRAME_UNIFORMS_BINDING);
+	shaderManager.BindUniformBlock("SimulationParameters",
+		Simulation::SIMULATION_PARAMETERS_BINDING);
 
+	// edited shader files are picked up while running, 'R' rebuilds all
+	shaderManager.EnableHotReload();
+	worldPrograms.GetShaderManager().EnableHotReload();
 
-	// WAVE PARTICLE DISTRIBUTION TEXTURE
+	// the world has its own, this one is for rendering
+	Shaders::UniformBuffer<Simulation::FrameUniforms> frameUniformBuffer(
+		Simulation::FRAME_UNIFORMS_BINDING);
 
-	// framebuffer target
-	GLuint wpdTextureFramebuffer;
-	glGenFramebuffers(1, &wpdTextureFramebuffer);
+	// TIMER, a replay renders as fast as it can
+	Utilities::MainTimer timer(60, inputReplayer ? 0 : 30);
+	if (inputReplayer) glfwSwapInterval(0);
+	GLfloat lastTime = glfwGetTime();
+	GLfloat nowTime;
+	GLfloat deltaTime;
 
-	glBindFramebuffer(GL_FRAMEBUFFER, wpdTextureFramebuffer);
+	// the time seen by the simulation, one tick per rendered frame
+	const double DETERMINISTIC_TIME_STEP = inputReplayer
+		? inputReplayer->GetHeader().TimeStep : 1.0 / 60.0;
+	if (deterministic) {
+		worldSettings.TimeStep = DETERMINISTIC_TIME_STEP;
+		worldSettings.Seed = deterministicSeed;
+	}
 
-	// to complete the framebuffer, we need:
-	//   - at least one attachment (color, depth, or stencil)
-	//   - at least one color attachment
-	//   - all attachments should be complete, with reserved memory
-	//   - each buffer should have the same number of samples (for multi-sampling)
 
-	// define texture as resolution N x N
-	const int WPD_TEXTURE_SIZE = 128;
+	// TERRAIN
 
-	GLuint wpdTexture;
-	glGenTextures(1, &wpdTexture);
-	glBindTexture(GL_TEXTURE_2D, wpdTexture);
+	// particles reflect at land, and slow down over shallow water.
+	// Without a height map the whole domain is open ocean.
+	const GLfloat TERRAIN_MIN_HEIGHT = -50.0f;
+	const GLfloat TERRAIN_MAX_HEIGHT = 50.0f;
+	const GLfloat TERRAIN_SEA_LEVEL = 0.0f;
+	const GLfloat TERRAIN_SHALLOW_DEPTH = 5.0f;
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, WPD_TEXTURE_SIZE, WPD_TEXTURE_SIZE, 0,
-		GL_RGB, GL_FLOAT, nullptr);
+	Terrain::HeightMap* terrainHeightMap = nullptr;
+	if (heightMapFile != nullptr)
+	{
+		terrainHeightMap = Terrain::LoadHeightMap(heightMapFile,
+			TERRAIN_MIN_HEIGHT, TERRAIN_MAX_HEIGHT);
+	}
+	if (terrainHeightMap != nullptr)
+	{
+		Terrain::ClassifyHeights(*terrainHeightMap, TERRAIN_SEA_LEVEL, TERRAIN_SHALLOW_DEPTH);
+	}
 
-	glBindTexture(GL_TEXTURE_2D, 0);
 
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, wpdTexture, 0);
+	// THE SIMULATION, which owns the terrain from here on
+	world = new Simulation::World(worldPrograms, worldSettings, terrainHeightMap);
+	const int WPD_TEXTURE_SIZE = world->GetTextureSize();
+	const GLuint wpdTexture = world->GetHeightTexture();
 
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	// input recorded now takes effect at the next tick
+	if (recordFile != nullptr)
 	{
-		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+		inputRecorder = new Simulation::InputRecorder(recordFile, deterministicSeed,
+			DETERMINISTIC_TIME_STEP);
+		inputRecorder->SetTick(world->GetClock().GetTick() + 1);
+		std::cout << "Recording input to '" << recordFile << "'" << std::endl;
 	}
-		
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+	// a single particle to begin with
+	auto emitFirstParticle = [](Simulation::World& target) {
+		GLfloat posX = target.GetRandom().NextFloat(-1.0f, 1.0f);
+		GLfloat posY = target.GetRandom().NextFloat(-1.0f, 1.0f);
+		PackedWaveParticle particle;
 
+		// (Position.x, Position.y, PropagationAngle, DispersionAngle)
+		particle.paramVec1 = glm::vec4(posX, posY, 0, glm::pi<GLfloat>() * 2.0f);
 
+		// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
+		particle.paramVec2 = glm::vec4(posX, posY, target.GetClock().GetTime(), 0.3f * 0.5f);
 
+		// (Radius, Amplitude, nBorderFrames)
+		particle.paramVec3 = glm::vec4(0.025f, 25.0f, 0.0f, 0.0f);
+		target.Emit(particle);
+	};
+	emitFirstParticle(*world);
 
-	// WAVE PARTICLE DISTRIBUTION TEXTURE - CLEANUP
-	Shaders::ShaderWrapper wpdTextureCleanupShader(
-		"..|shaders|waveParticles|distributionTextureCleanup", Shaders::SHADER_TYPE_VF);
+	// more worlds, stepped together with the first one, each with its own seed
+	Simulation::WorldScheduler worldScheduler;
+	worldScheduler.Add(*world);
+	std::vector<Simulation::World*> otherWorlds;
+	for (int i = 1; i < numWorlds; i++)
+	{
+		Simulation::WorldSettings otherSettings = worldSettings;
+		otherSettings.Seed = worldSettings.Seed + (uint32_t)i;
+		otherWorlds.push_back(new Simulation::World(worldPrograms, otherSettings));
+		emitFirstParticle(*otherWorlds.back());
+		worldScheduler.Add(*otherWorlds.back());
+	}
+	if (numWorlds > 1)
+	{
+		std::cout << "Simulating " << numWorlds << " worlds" << std::endl;
+	}
 
-	GLfloat wpdTextureCleanupQuadData[] = {
-		// lower-left triangle
-		-1.0f, 1.0f,
-		1.0f, 1.0f,
-		-1.0f, -1.0f,
-		// upper-right triangle
-		1.0f, 1.0f,
-		1.0f, -1.0f,
-		-1.0f, -1.0f
-	};
-	GLuint wpdTextureVAO;
-	GLuint wpdTextureVBO;
-	glGenVertexArrays(1, &wpdTextureVAO);
-	glBindVertexArray(wpdTextureVAO);
+	// a tiled ocean, with a ring in every tile. Tiles more than a tile away
+	// from its centre step every fourth tick.
+	Simulation::TiledWorld* tiledWorld = nullptr;
+	if (numTiles > 0)
+	{
+		Simulation::WorldSettings tileSettings = worldSettings;
+		tileSettings.InitialParticleCapacity = 4096;
+		tiledWorld = new Simulation::TiledWorld(worldPrograms, tileSettings, numTiles, numTiles);
+		tiledWorld->SetFocus(glm::vec2(0.0f), 2.0f, 4);
 
-	glGenBuffers(1, &wpdTextureVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, wpdTextureVBO);
+		Utilities::CounterRandom tileRandom(tileSettings.Seed, 1);
+		for (int i = 0; i < numTiles * numTiles; i++)
+		{
+			const GLfloat posX = tileRandom.NextFloat(-1.0f, 1.0f) * numTiles;
+			const GLfloat posY = tileRandom.NextFloat(-1.0f, 1.0f) * numTiles;
+			PackedWaveParticle particle;
+			particle.paramVec1 = glm::vec4(posX, posY, 0, glm::pi<GLfloat>() * 2.0f);
+			particle.paramVec2 = glm::vec4(posX, posY, tiledWorld->GetClock().GetTime(), 0.3f * 0.5f);
+			particle.paramVec3 = glm::vec4(0.025f, 25.0f, 0.0f, 0.0f);
+			tiledWorld->Emit(particle);
+		}
+		std::cout << "Simulating " << numTiles << " x " << numTiles << " tiles" << std::endl;
+	}
 
-	glBufferData(GL_ARRAY_BUFFER, sizeof(wpdTextureCleanupQuadData),
-		wpdTextureCleanupQuadData, GL_STATIC_DRAW);
 
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+	// total running time
+	GLint64 timeElapsedTotal = 0;
+	double timeElapsedTotalMilliseconds = 0;
+	GLuint timeElapsedTotalQueryObject;
+	glGenQueries(1, &timeElapsedTotalQueryObject);
 
-	glBindVertexArray(0);
 
 
+	// HEIGHT MAP FOR WATER SURFACE VISUALIZATION
 
-	// WAVE PARTICLE DISTRIBUTION TEXTURE - BLENDING
-	Shaders::ShaderWrapper wpdTextureParticleBlendingShader(
-		"..|shaders|waveParticles|particleBlending", Shaders::SHADER_TYPE_VF);
+	// same size as Wave Particle Distribution Texture
+	Terrain::WaterMesh* waterSurfaceMesh = new Terrain::WaterMesh(WPD_TEXTURE_SIZE);
 
-	/*glm::mat4 projection = glm::ortho(0, WPD_TEXTURE_SIZE, 0, WPD_TEXTURE_SIZE);
-	wpdTextureParticleBlendingShader.Activate();
-	wpdTextureParticleBlendingShader.SetUniform("projection", &projection);
-	wpdTextureParticleBlendingShader.Deactivate();*/
+	glm::mat4 viewProjection(1.0f);
+	Simulation::FrameUniforms frameUniforms;
+	auto updateViewProjection = [&]() {
+		cam->CalculateViewProjection();
+		viewProjection = glm::mat4(1.0f);
+		viewProjection *= *(cam->GetProjectionMatrix());
+		viewProjection *= *(cam->GetViewMatrix());
+
+		frameUniforms.viewProjection = viewProjection;
+		frameUniforms.cameraPosition = glm::vec4(cam->GetPosition(), 1.0f);
+	};
+	updateViewProjection();
+	frameUniforms.time = (GLfloat)world->GetClock().GetTime();
+	frameUniforms.mapSize = (GLfloat)WPD_TEXTURE_SIZE;
 
+	waterSurfaceMeshShader.Activate();
 
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, wpdTexture);
+	waterSurfaceMeshShader.SetUniformTexture("wpdTexture", 0);
 
+	waterSurfaceMeshShader.Deactivate();
 
-	// DATA FOR TRANSFORM FEEDBACK
 
-	// visualizing shader
-	Shaders::ShaderWrapper visualizeShader("..|shaders|point", Shaders::SHADER_TYPE_VGF);
+	// EVENT-DRIVEN PROPAGATION ON THE CPU (toggled with 'C')
 
-	// TF shader
-	const GLchar* imageTFShaderOutputs[] = { 
-		"paramVec1", "paramVec2", "paramVec3" 
+	// wave fronts finer than this on screen are merged back
+	// (the transform feedback pass cannot see neighbouring particles)
+	const GLfloat LOD_MIN_PIXEL_SPACING = 2.0f;
+	auto updateLevelOfDetailView = [&]() {
+		Simulation::LevelOfDetailView lodView;
+		lodView.ViewProjection = viewProjection;
+		lodView.Viewport = glm::vec2(aspect.GetWidth(), aspect.GetHeight());
+		lodView.MapSize = (GLfloat)WPD_TEXTURE_SIZE;
+		lodView.MinPixelSpacing = LOD_MIN_PIXEL_SPACING;
+		world->SetLevelOfDetailView(lodView);
 	};
-	Shaders::ShaderWrapper imageTFShader("..|shaders|waveParticles|particlePropagation",
-		Shaders::TF_SHADER_TYPE_VG, imageTFShaderOutputs, 3);
-	imageTFShader.Activate();
+	updateLevelOfDetailView();
 
-	int read = 0;
-	int write = 1;
 
-	GLuint vao;
-	GLuint tbo[2];
+	// SNAPSHOTS
 
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	Simulation::SnapshotWriter snapshotWriter;
 
-	const int MAX_PARTICLES = 200000;
-	const int NUM_PARTICLES = 1;
-	PackedWaveParticle data[NUM_PARTICLES];
-	const GLsizeiptr numParticlesSize = NUM_PARTICLES * sizeof(PackedWaveParticle);
-	const GLsizeiptr particleBufferSize = MAX_PARTICLES * sizeof(PackedWaveParticle);
 
-	for (int i = 0; i < NUM_PARTICLES; i++)
-	{
-		GLfloat posX = Random::NextFloat(-1.0f, 1.0f);
-		GLfloat posY = Random::NextFloat(-1.0f, 1.0f);
+	// HEIGHT QUERIES
 
-		// (Position.x, Position.y, PropagationAngle, DispersionAngle)
-		data[i].paramVec1 = glm::vec4(posX, posY, 0, glm::pi<GLfloat>() * 2.0f);
+	// on the GPU, results arrive a frame or two later. In CPU mode, the
+	// heights are evaluated right away from the particles instead, which are
+	// indexed once per tick.
+	auto printHeights = [](uint64_t ticket, const GLfloat* heights, size_t count) {
+		if (count == 0) return;
+		GLfloat minHeight = heights[0], maxHeight = heights[0];
+		for (size_t i = 1; i < count; i++) {
+			minHeight = std::min(minHeight, heights[i]);
+			maxHeight = std::max(maxHeight, heights[i]);
+		}
+		printf("Height query %llu: %zu points, heights in [%f, %f]\n",
+			(unsigned long long)ticket, count, minHeight, maxHeight);
+	};
 
-		// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
-		data[i].paramVec2 = glm::vec4(posX, posY, glfwGetTime(), 0.3f * 0.5f);
 
-		// (Radius, Amplitude, nBorderFrames)
-		data[i].paramVec3 = glm::vec4(0.025f, 25.0f, 0.0f, 0.0f);
+	// HEIGHT FIELD EXPORT
+
+	Simulation::HeightFieldExporter* heightFieldExporter = nullptr;
+	if (exportFile != nullptr)
+	{
+		heightFieldExporter = new Simulation::HeightFieldExporter(exportFile,
+			WPD_TEXTURE_SIZE, WPD_TEXTURE_SIZE);
+		std::cout << "Exporting the height field to '" << exportFile << "' every "
+			<< exportInterval << " ticks" << std::endl;
 	}
 
-	
-	/* COMMENT BACK TO CREATE 5 STATICALLY POSITIONED PARTICLES
-	// PARTICLE 1
-	// (Position.x, Position.y, PropagationAngle, DispersionAngle)
-	data[0].paramVec1 = glm::vec4(0.0f, 0.0f, 0, glm::pi<GLfloat>() * 2.0f);
-	// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
-	data[0].paramVec2 = glm::vec4(0.0f, 0.0f, glfwGetTime(), 0.3f);
-	// (Radius, Amplitude, nBorderFrames)
-	data[0].paramVec3 = glm::vec4(0.01f, 0.1f, 0.0f, 0.0f); // TODO: Radius in NDC ??
-
-	// PARTICLE 2
-	data[1].paramVec1 = glm::vec4(-0.5f, 0.5f, 0, glm::pi<GLfloat>() * 2.0f);
-	data[1].paramVec2 = glm::vec4(-0.5f, 0.5f, glfwGetTime(), 0.3f);
-	data[1].paramVec3 = glm::vec4(0.01f, 0.1f, 0.0f, 0.0f);
-
-	// PARTICLE 3
-	data[2].paramVec1 = glm::vec4(0.5f, 0.5f, 0, glm::pi<GLfloat>() * 2.0f);
-	data[2].paramVec2 = glm::vec4(0.5f, 0.5f, glfwGetTime(), 0.3f);
-	data[2].paramVec3 = glm::vec4(0.01f, 0.1f, 0.0f, 0.0f);
-
-	// PARTICLE 4
-	data[3].paramVec1 = glm::vec4(0.5f, -0.5f, 0, glm::pi<GLfloat>() * 2.0f);
-	data[3].paramVec2 = glm::vec4(0.5f, -0.5f, glfwGetTime(), 0.3f);
-	data[3].paramVec3 = glm::vec4(0.01f, 0.1f, 0.0f, 0.0f);
-
-	// PARTICLE 5
-	data[4].paramVec1 = glm::vec4(-0.5f, -0.5f, 0, glm::pi<GLfloat>() * 2.0f);
-	data[4].paramVec2 = glm::vec4(-0.5f, -0.5f, glfwGetTime(), 0.3f);
-	data[4].paramVec3 = glm::vec4(0.01f, 0.1f, 0.0f, 0.0f);
-	*/
-
-
-
-	glGenBuffers(2, tbo);
-	glBindBuffer(GL_ARRAY_BUFFER, tbo[read]);
-	glBufferData(GL_ARRAY_BUFFER, particleBufferSize, nullptr, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, numParticlesSize, data);
-
-	// void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid * data);
-	//
-	// target : Specifies the target buffer object.The symbolic constant must be 
-	//          GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER, or
-	//          GL_PIXEL_UNPACK_BUFFER.
-	// offset : Specifies the offset into the buffer object's data store where data
-	//          replacement will begin, measured in bytes.
-	// size : Specifies the size in bytes of the data store region being replaced.
-	// data : Specifies a pointer to the new data that will be copied into the data store.
-
-
-	glBindBuffer(GL_ARRAY_BUFFER, tbo[write]);
-	glBufferData(GL_ARRAY_BUFFER, particleBufferSize, nullptr, GL_STATIC_DRAW);
-
-	// query Transform Feedback (TF) number of particles output
-	GLuint nParticlesAlive = NUM_PARTICLES;
-	GLuint nParticlesAliveQueryObject;
-	glGenQueries(1, &nParticlesAliveQueryObject);
-
-	// query TF shader running time
-	GLint64 timeElapsedTFShader = 0;
-	double timeElapsedMilliseconds = 0;
-	GLuint timeElapsedTFShaderQueryObject;
-	glGenQueries(1, &timeElapsedTFShaderQueryObject);
-
-	glBindVertexArray(0);
+	// the particles go straight from the mapped file into the world. In CPU
+	// mode, the event-driven engine is rebuilt from them by the handover.
+	auto restoreSnapshot = [&](const std::string& filePath) {
+		Simulation::Snapshot snapshot(filePath);
+		if (!snapshot.IsValid()) return;
+
+		const Simulation::SnapshotHeader& header = snapshot.GetHeader();
+		if (!world->LoadParticles((const PackedWaveParticle*)snapshot.GetParticles(),
+			header.NumParticles)) {
+			fprintf(stderr, "---> ERROR: the %u particles of '%s' exceed the particle budget!\n",
+				header.NumParticles, filePath.c_str());
+			return;
+		}
 
+		world->GetClock().Restore(header.Tick, header.Time);
+		world->SetRandom(header.Seed, header.RandomCounter);
+		world->SetParameters(header.Parameters);
+		world->SetPropagate((header.Flags & Simulation::SNAPSHOT_FLAG_PROPAGATE) != 0);
+		world->SetCreateRemote((header.Flags & Simulation::SNAPSHOT_FLAG_CREATE_REMOTE) != 0);
+		world->SetCpuPropagation((header.Flags & Simulation::SNAPSHOT_FLAG_CPU_PROPAGATION) != 0);
 
-	// total running time
-	GLint64 timeElapsedTotal = 0;
-	double timeElapsedTotalMilliseconds = 0;
-	GLuint timeElapsedTotalQueryObject;
-	glGenQueries(1, &timeElapsedTotalQueryObject);
+		printf("Restored %u particles at tick %llu from '%s'\n", world->GetNumParticles(),
+			(unsigned long long)header.Tick, filePath.c_str());
+	};
 
 
+	// TESSELLATED WATER SURFACE (OpenGL 4.0+, toggled with 'T')
 
-	// HEIGHT MAP FOR WATER SURFACE VISUALIZATION
+	// coarse patch grid, refined where the camera is close and
+	// where the wave particles actually are
+	const int WATER_PATCH_SIZE = 16;
+	Terrain::WaterPatchMesh* waterSurfacePatchMesh = nullptr;
 
-	// same size as Wave Particle Distribution Texture
-	Terrain::WaterMesh* waterSurfaceMesh = new Terrain::WaterMesh(WPD_TEXTURE_SIZE);
+	if (isTessellationSupported)
+	{
+		waterSurfacePatchMesh = new Terrain::WaterPatchMesh(WPD_TEXTURE_SIZE,
+			WATER_PATCH_SIZE);
 
-	Shaders::ShaderWrapper waterSurfaceMeshShader("..|shaders|waveParticles|waterSurface",
-		Shaders::SHADER_TYPE_VF);
+		// (min level, max level, amplitude at max level, distance at max level)
+		glm::vec4 tessellationParams(1.0f, (GLfloat)WATER_PATCH_SIZE, 1.0f, 60.0f);
 
-	waterSurfaceMeshShader.Activate();
+		waterSurfacePatchShader->Activate();
+		waterSurfacePatchShader->SetUniform("tessellationParams", tessellationParams);
+		waterSurfacePatchShader->SetUniformTexture("wpdTexture", 0);
+		waterSurfacePatchShader->Deactivate();
+	}
+	else
+	{
+		std::cout << "Tessellated water surface disabled (requires OpenGL 4.0)" << std::endl;
+	}
 
-	cam->CalculateViewProjection();
-	glm::mat4 viewProjection(1.0f);
-	viewProjection *= *(cam->GetProjectionMatrix());
-	viewProjection *= *(cam->GetViewMatrix());
-	waterSurfaceMeshShader.SetUniform("viewProjection", &viewProjection);
-	waterSurfaceMeshShader.SetUniform("mapSize", (GLfloat)WPD_TEXTURE_SIZE);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, wpdTexture);
-	waterSurfaceMeshShader.SetUniformTexture("wpdTexture", 0);
-
-	waterSurfaceMeshShader.Deactivate();
+	// checksum of the particles after the current tick, every
+	// CHECKSUM_INTERVAL ticks in deterministic mode
+	const uint64_t CHECKSUM_INTERVAL = 60;
+	std::vector<PackedWaveParticle> checksumParticles;
+	auto printChecksum = [&]() {
+		world->ReadParticles(checksumParticles);
+		uint64_t checksum = Hash::Fnv1a64(checksumParticles.data(),
+			checksumParticles.size() * sizeof(PackedWaveParticle));
+		printf("tick %llu: %zu particles, checksum %016llx\n",
+			(unsigned long long)world->GetClock().GetTick(), checksumParticles.size(),
+			(unsigned long long)checksum);
+	};
 
 
 	// GAME LOOP
@@ -393,215 +635,116 @@ int main()
 			deltaTime = nowTime - lastTime;
 			lastTime = nowTime;
 			win->PollEvents();
-			if (MoveCamera(deltaTime)) { camUpdate = true; }
+			// a deterministic camera moves once per tick instead, see below
+			if (!deterministic && MoveCamera(deltaTime)) { camUpdate = true; }
 		}
 
 		if (camUpdate) {
-			waterSurfaceMeshShader.Activate();
+			updateViewProjection();
+			updateLevelOfDetailView();
+		}
 
-			cam->CalculateViewProjection();
-			viewProjection = glm::mat4(1.0f);
-			viewProjection *= *(cam->GetProjectionMatrix());
-			viewProjection *= *(cam->GetViewMatrix());
-			waterSurfaceMeshShader.SetUniform("viewProjection", &viewProjection);
+		if (loadSnapshot) {
+			restoreSnapshot(snapshotFile);
+			loadSnapshot = false;
+		}
 
-			waterSurfaceMeshShader.Deactivate();
+		if (reloadShaders) {
+			shaderManager.ReloadAll();
+			worldPrograms.GetShaderManager().ReloadAll();
+			reloadShaders = false;
+		}
+		else {
+			shaderManager.PollReload();
+			worldPrograms.GetShaderManager().PollReload();
 		}
 		
 		if (timer.ShouldRender()) {
 			win->ClearWindow();
 
-			// CHECK WHETHER A NEW PARTICLE SHOULD BE SPAWNED
-			if (spawnNewParticle)
-			{
-				//std::cout << "yes" << std::endl;
-				glBindVertexArray(vao);
-
-				PackedWaveParticle newParticle[1];
-				PackedWaveParticle::GenerateRandom(newParticle[0]);
-
-				// void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid * data);
-				//
-				// target : Specifies the target buffer object.The symbolic constant must be 
-				//          GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER, or
-				//          GL_PIXEL_UNPACK_BUFFER.
-				// offset : Specifies the offset into the buffer object's data store where data
-				//          replacement will begin, measured in bytes.
-				// size : Specifies the size in bytes of the data store region being replaced.
-				// data : Specifies a pointer to the new data that will be copied into the data store.
-				glBindBuffer(GL_ARRAY_BUFFER, tbo[read]);
-				//std::cout << "particles alive: " << nParticlesAlive << std::endl;
-				//std::cout << "offset = " << nParticlesAlive * sizeof(PackedWaveParticle) << ", size = " << sizeof(PackedWaveParticle) << std::endl;
-				const GLintptr offset = nParticlesAlive * sizeof(PackedWaveParticle);
-				const GLsizeiptr size = sizeof(PackedWaveParticle);
-				glBufferSubData(GL_ARRAY_BUFFER, offset, size, (GLvoid*)newParticle);
-				glFlush();
-				glFinish();
-				nParticlesAlive++;
-
-				glBindVertexArray(0);
+			// input of the next tick, from the log or as it is recorded
+			const uint64_t tick = world->GetClock().GetTick() + 1;
+			if (inputReplayer) {
+				inputReplayer->Replay(tick, [](int key, int action) {
+					KeyCallback(nullptr, key, 0, action, 0);
+				});
 			}
-
-			glBeginQuery(GL_TIME_ELAPSED, timeElapsedTotalQueryObject);
-
-
-			// PERFORM TRANSFORM FEEDBACK
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-			glBindVertexArray(vao);
-
-			imageTFShader.Activate();
-			imageTFShader.SetUniform("time", (GLfloat)glfwGetTime());
-			glBindBuffer(GL_ARRAY_BUFFER, tbo[read]);
-
-			// (Position.x, Position.y, PropagationAngle, DispersionAngle)
-			glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)0);
-			glEnableVertexAttribArray(0);
-
-			// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
-			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)(sizeof(glm::vec4)));
-			glEnableVertexAttribArray(1);
-
-			// (Radius, Amplitude, nBorderFrames)
-			glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)(2 * sizeof(glm::vec4)));
-			glEnableVertexAttribArray(2);
-
-			glEnable(GL_RASTERIZER_DISCARD);
-
-			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, tbo[write]);
-			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, tbo[write]);
-			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 2, tbo[write]);
-
-			glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, nParticlesAliveQueryObject);
-			//glBeginQuery(GL_TIME_ELAPSED, timeElapsedTFShaderQueryObject);
-			{
-				glBeginTransformFeedback(GL_POINTS);
-				glDrawArrays(GL_POINTS, 0, nParticlesAlive);
-				glEndTransformFeedback();
+			if (deterministic && MoveCamera((GLfloat)DETERMINISTIC_TIME_STEP)) {
+				updateViewProjection();
+				updateLevelOfDetailView();
 			}
-			//glEndQuery(GL_TIME_ELAPSED);
-			glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
-
-			glGetQueryObjectuiv(nParticlesAliveQueryObject, GL_QUERY_RESULT, &nParticlesAlive);
-			//glGetQueryObjecti64v(timeElapsedTFShaderQueryObject, GL_QUERY_RESULT,
-			//	&timeElapsedTFShader);
 
-			glDisable(GL_RASTERIZER_DISCARD);
-			glFlush();
-			imageTFShader.Deactivate();
-
-			glBindVertexArray(0);
-
-
-
-
-			// CLEAN WAVE PARTICLE DISTRIBUTION TEXTURE FROM PREVIOUS RENDERING CALLS
-			glViewport(0, 0, WPD_TEXTURE_SIZE, WPD_TEXTURE_SIZE);
-
-			glBindFramebuffer(GL_FRAMEBUFFER, wpdTextureFramebuffer);
-
-			wpdTextureCleanupShader.Activate();
-			glBindVertexArray(wpdTextureVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			glBindVertexArray(0);
-			wpdTextureCleanupShader.Deactivate();
-			glFlush();
-
-
-
-
-			// RENDER WAVE PARTICLE DISTRIBUTION TEXTURE
-
-			// set attribute pointers
-			glBindVertexArray(vao);
-
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glBindBuffer(GL_ARRAY_BUFFER, tbo[write]);
-
-			// (Position.x, Position.y, PropagationAngle, DispersionAngle)
-			glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)0);
-			glEnableVertexAttribArray(0);
-
-			// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
-			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)(sizeof(glm::vec4)));
-			glEnableVertexAttribArray(1);
-
-			// (Radius, Amplitude, nBorderFrames)
-			glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)(2 * sizeof(glm::vec4)));
-			glEnableVertexAttribArray(2);
-
-			// Enable additive blending, such that fragments are not overwritten
-			// but blended (added) together
-			GLboolean isBlendingEnabled;
-			glGetBooleanv(GL_BLEND, &isBlendingEnabled);
-
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_ONE, GL_ONE);
-			glBlendEquation(GL_FUNC_ADD);
-			glEnable(GL_PROGRAM_POINT_SIZE);
-
-			// now particles can be rendered onto the 'wave particle distribution texture',
-			// which for each texel contains information about neighbouring particles
-			wpdTextureParticleBlendingShader.Activate();
-
-			glDrawArrays(GL_POINTS, 0, nParticlesAlive);
-
-			wpdTextureParticleBlendingShader.Deactivate();
-
-			glBindVertexArray(0);
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glDisable(GL_BLEND);
-			glDisable(GL_PROGRAM_POINT_SIZE);
-
-
-
-
-			// RENDER TRANSFORM FEEDBACK RESULT
-			glViewport(0, 0, aspect.GetWidth(), aspect.GetHeight());
-
-			/*
-			glBindVertexArray(vao);
+			// CHECK WHETHER A NEW PARTICLE SHOULD BE SPAWNED
+			if (spawnNewParticle) {
+				world->EmitRandom();
+			}
 
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glBindBuffer(GL_ARRAY_BUFFER, tbo[write]);
+			// GPU height queries are evaluated during the step
+			std::vector<glm::vec2> queryPositions;
+			if (queryHeights) {
+				const int QUERY_GRID_SIZE = 16;
+				for (int y = 0; y < QUERY_GRID_SIZE; y++) {
+					for (int x = 0; x < QUERY_GRID_SIZE; x++) {
+						queryPositions.push_back(glm::vec2(x + 0.5f, y + 0.5f)
+							* (2.0f / QUERY_GRID_SIZE) - 1.0f);
+					}
+				}
+				if (!world->IsCpuPropagation() &&
+					world->SubmitHeightQuery(queryPositions.data(), queryPositions.size()) == 0) {
+					std::cout << "Height query dropped, all slots are in flight" << std::endl;
+				}
+				queryHeights = false;
+			}
 
-			// (Position.x, Position.y, PropagationAngle, DispersionAngle)
-			glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)0);
-			glEnableVertexAttribArray(0);
+			glBeginQuery(GL_TIME_ELAPSED, timeElapsedTotalQueryObject);
 
-			// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
-			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)(sizeof(glm::vec4)));
-			glEnableVertexAttribArray(1);
+			// PROPAGATE, AND RENDER THE WAVE PARTICLE DISTRIBUTION TEXTURES
+			worldScheduler.Step();
+			if (tiledWorld) {
+				tiledWorld->Step();
+			}
+			if (inputRecorder) {
+				inputRecorder->SetTick(world->GetClock().GetTick() + 1);
+			}
 
-			// (Radius, Amplitude, nBorderFrames)
-			glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
-				(GLvoid*)(2 * sizeof(glm::vec4)));
-			glEnableVertexAttribArray(2);
+			// identical runs print identical checksums at identical ticks,
+			// no matter the frame rate
+			if (deterministic && world->GetClock().GetTick() % CHECKSUM_INTERVAL == 0) {
+				printChecksum();
+			}
 
-			visualizeShader.Activate();
-			glDrawArrays(GL_POINTS, 0, nParticlesAlive);
-			visualizeShader.Deactivate();
+			// HEIGHT QUERIES, on the distribution texture of this tick
+			if (!queryPositions.empty() && world->IsCpuPropagation()) {
+				std::vector<GLfloat> heights(queryPositions.size());
+				if (world->GetHeights(queryPositions.data(), heights.data(), heights.size())) {
+					printHeights(0, heights.data(), heights.size());
+				}
+			}
+			world->PollHeightQueries(printHeights);
 
-			glBindVertexArray(0);
-			*/
+			// one upload of the shared per-frame state, for all programs
+			frameUniforms.time = (GLfloat)world->GetClock().GetTime();
+			frameUniformBuffer.Update(frameUniforms);
+			frameUniformBuffer.Bind();
 
 
 			// RENDER WATER SURFACE
 			glPolygonMode(GL_FRONT_AND_BACK, waterSurfacePolygonMode);
 
-			waterSurfaceMeshShader.Activate();
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, wpdTexture);
-			waterSurfaceMesh->Render();
-			waterSurfaceMeshShader.Deactivate();
+			if (tessellateWaterSurface && isTessellationSupported) {
+				waterSurfacePatchShader->Activate();
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, wpdTexture);
+				waterSurfacePatchMesh->Render();
+				waterSurfacePatchShader->Deactivate();
+			}
+			else {
+				waterSurfaceMeshShader.Activate();
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, wpdTexture);
+				waterSurfaceMesh->Render();
+				waterSurfaceMeshShader.Deactivate();
+			}
 
 
 			glEndQuery(GL_TIME_ELAPSED);
@@ -609,30 +752,79 @@ int main()
 				&timeElapsedTotal);
 
 
+			// the height field of this tick, written out a frame or more later
+			if (heightFieldExporter) {
+				if (world->GetClock().GetTick() % exportInterval == 0) {
+					heightFieldExporter->Capture(world->GetDistributionFramebuffer(),
+						world->GetClock().GetTick(), world->GetClock().GetTime());
+				}
+				heightFieldExporter->Poll();
+			}
+
+
 			// DOUBLE_BUFFERING
 			win->SwapBuffers();
 
-			// SWAPPING TF BUFFERS
-			int temp = read;
-			read = write;
-			write = temp;
+			// the state after this tick, written once the GPU has copied it
+			if (saveSnapshot) {
+				Simulation::SnapshotHeader header = {};
+				header.NumParticles = world->GetNumParticles();
+				header.Tick = world->GetClock().GetTick();
+				header.Time = world->GetClock().GetTime();
+				header.TimeStep = world->GetClock().GetStep();
+				header.Seed = world->GetSeed();
+				header.RandomCounter = world->GetRandom().GetCounter();
+				header.Parameters = world->GetParameters();
+				header.Flags =
+					(world->IsPropagating() ? Simulation::SNAPSHOT_FLAG_PROPAGATE : 0) |
+					(world->IsCreatingRemote() ? Simulation::SNAPSHOT_FLAG_CREATE_REMOTE : 0) |
+					(world->IsCpuPropagation() ? Simulation::SNAPSHOT_FLAG_CPU_PROPAGATION : 0);
+				if (snapshotWriter.Capture(world->GetParticleBuffer(), header, snapshotFile)) {
+					saveSnapshot = false;
+				}
+			}
+			snapshotWriter.Poll();
+
+			if (inputReplayer && inputReplayer->IsFinished(world->GetClock().GetTick())) {
+				win->CloseWindow();
+			}
 		}
 
 		if (timer.ShouldReset()) {
 			//timeElapsedMilliseconds = timeElapsedTFShader / 1000000.0;
 			timeElapsedTotalMilliseconds = timeElapsedTotal / 1000000.0;
 			win->SetTitle(timer.GetTimeTitle() + " | particles alive: "
-				+ std::to_string(nParticlesAlive)
+				+ std::to_string(worldScheduler.GetNumParticles())
+				+ (numWorlds > 1 ? " in " + std::to_string(numWorlds) + " worlds" : std::string())
+				+ (tiledWorld ? " | in tiles: " + std::to_string(tiledWorld->GetNumParticles())
+					+ ", migrated: " + std::to_string(tiledWorld->GetNumMigrated()) : std::string())
+				+ (world->IsCpuPropagation() ? " | events: " + std::to_string(
+					world->GetEventsProcessed()) : std::string())
 				+ " | Total shader time (ms): " + std::to_string(timeElapsedTotalMilliseconds));
 			std::cout << win->GetTitle() << std::endl;
 		}
 	}
 
+	snapshotWriter.Poll(true);
+	delete heightFieldExporter;
+
+	// a recording and its replay end on the same checksum
+	if (deterministic) {
+		printChecksum();
+	}
+	if (inputRecorder) {
+		inputRecorder->Close(world->GetClock().GetTick());
+		delete inputRecorder;
+	}
+	delete inputReplayer;
+
 	// cleanup
 	delete waterSurfaceMesh;
-	glDeleteQueries(1, &nParticlesAliveQueryObject);
-	glDeleteBuffers(2, tbo);
-	glDeleteVertexArrays(1, &vao);
+	delete waterSurfacePatchMesh;
+	delete tiledWorld;
+	for (Simulation::World* otherWorld : otherWorlds) delete otherWorld;
+	delete world;
+	glDeleteQueries(1, &timeElapsedTotalQueryObject);
 
 	delete cam;
 	delete win;
@@ -0,0 +1,175 @@
+// the C interface of WaveParticlesLib.h, on top of World.h
+
+// STANDARD
+#include <memory>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+// CUSTOM
+#include "WaveParticlesLib.h"
+#include "World.h"
+#include "HeightMapLoader.h"
+
+using namespace Simulation;
+
+
+struct wp_world
+{
+	std::shared_ptr<WorldPrograms> Programs;
+	std::unique_ptr<World> Instance;
+};
+
+// worlds with the same shader root share their programs, such that
+// wp_world_step_all can batch their passes
+static std::shared_ptr<WorldPrograms> acquirePrograms(const WorldSettings& settings)
+{
+	static std::map<std::string, std::weak_ptr<WorldPrograms>> cache;
+	std::weak_ptr<WorldPrograms>& cached = cache[settings.ShaderRoot];
+	std::shared_ptr<WorldPrograms> programs = cached.lock();
+	if (programs == nullptr)
+	{
+		programs = std::make_shared<WorldPrograms>(settings.ShaderRoot,
+			settings.MaxSubdivisionBranches);
+		cached = programs;
+	}
+	return programs;
+}
+
+extern "C" int wp_load_gl(wp_gl_loader loader)
+{
+	if (!gladLoadGLLoader((GLADloadproc)loader)) return 0;
+
+	// entry points not covered by the GLAD loader
+	OpenGL::LoadExtensions((GLADloadproc)loader);
+	return 1;
+}
+
+extern "C" wp_world* wp_world_create(const wp_world_desc* desc)
+{
+	const wp_world_desc empty = {};
+	if (desc == nullptr) desc = &empty;
+
+	WorldSettings settings;
+	if (desc->shader_root != nullptr) settings.ShaderRoot = desc->shader_root;
+	if (desc->texture_size > 0) settings.TextureSize = desc->texture_size;
+	if (desc->particle_budget > 0) settings.ParticleBudget = desc->particle_budget;
+	settings.TimeStep = desc->time_step;
+	if (desc->seed != 0) settings.Seed = desc->seed;
+
+	Terrain::HeightMap* terrain = nullptr;
+	if (desc->terrain_heights != nullptr && desc->terrain_size > 0)
+	{
+		const unsigned int size = (unsigned int)desc->terrain_size;
+		terrain = new Terrain::HeightMap(size);
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				terrain->SetHeight(x, y, desc->terrain_heights[(size_t)y * size + x]);
+			}
+		}
+		Terrain::ClassifyHeights(*terrain, desc->sea_level, desc->shallow_depth);
+	}
+
+	wp_world* world = new wp_world();
+	world->Programs = acquirePrograms(settings);
+	world->Instance = std::make_unique<World>(*world->Programs, settings, terrain);
+	return world;
+}
+
+extern "C" void wp_world_destroy(wp_world* world)
+{
+	// the world before the programs it was created with
+	if (world != nullptr) world->Instance.reset();
+	delete world;
+}
+
+extern "C" void wp_world_emit(wp_world* world, const wp_particle* particles, size_t count)
+{
+	const GLfloat time = (GLfloat)world->Instance->GetClock().GetTime();
+	for (size_t i = 0; i < count; i++)
+	{
+		const wp_particle& p = particles[i];
+		const GLfloat sign = (p.amplitude < 0.0f) ? -1.0f : 1.0f;
+		PackedWaveParticle packed;
+
+		// (Position.x, Position.y, PropagationAngle, DispersionAngle)
+		packed.paramVec1 = glm::vec4(p.x, p.y, p.direction, p.dispersion_angle);
+
+		// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
+		packed.paramVec2 = glm::vec4(p.x, p.y, time, p.velocity * sign);
+
+		// (Radius, Amplitude, nBorderFrames)
+		packed.paramVec3 = glm::vec4(p.radius, p.amplitude, 0.0f, 0.0f);
+		world->Instance->Emit(packed);
+	}
+}
+
+extern "C" void wp_world_step(wp_world* world)
+{
+	world->Instance->Step();
+}
+
+extern "C" void wp_world_step_all(wp_world* const* worlds, size_t count)
+{
+	std::vector<World*> batch;
+	batch.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!batch.empty() && worlds[i]->Programs != worlds[0]->Programs)
+		{
+			// different shader roots, nothing to batch
+			for (size_t j = 0; j < count; j++) worlds[j]->Instance->Step();
+			return;
+		}
+		batch.push_back(worlds[i]->Instance.get());
+	}
+	World::StepAll(batch.data(), batch.size());
+}
+
+extern "C" unsigned int wp_world_get_height_texture(const wp_world* world)
+{
+	return world->Instance->GetHeightTexture();
+}
+
+extern "C" int wp_world_get_texture_size(const wp_world* world)
+{
+	return world->Instance->GetTextureSize();
+}
+
+extern "C" size_t wp_world_get_num_particles(const wp_world* world)
+{
+	return world->Instance->GetNumParticles();
+}
+
+extern "C" double wp_world_get_time(const wp_world* world)
+{
+	return world->Instance->GetClock().GetTime();
+}
+
+extern "C" uint64_t wp_world_query_heights(wp_world* world, const float* positions, size_t count)
+{
+	static_assert(sizeof(glm::vec2) == 2 * sizeof(float), "positions are (x, y) pairs");
+	return world->Instance->SubmitHeightQuery((const glm::vec2*)positions, count);
+}
+
+extern "C" void wp_world_poll_heights(wp_world* world, wp_height_callback callback, void* user)
+{
+	world->Instance->PollHeightQueries(
+		[&](uint64_t ticket, const GLfloat* heights, size_t count) {
+			callback(user, ticket, heights, count);
+		});
+}
+
+extern "C" int wp_world_evaluate_heights(const wp_world* world, const float* positions,
+	float* heights, size_t count)
+{
+	return world->Instance->GetHeights((const glm::vec2*)positions, heights, count) ? 1 : 0;
+}
+
+extern "C" void wp_world_set_cpu_propagation(wp_world* world, int enabled)
+{
+	world->Instance->SetCpuPropagation(enabled != 0);
+}
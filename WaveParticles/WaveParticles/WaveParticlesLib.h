@@ -0,0 +1,114 @@
+///
+/// Wave Particles Library
+///
+/// C interface to the simulation, for applications that bring their own
+/// window, GL context (3.3 core or later), and render thread. Every call
+/// must be made on the thread the context is current on, and wp_load_gl
+/// must be called once before the first world is created.
+///
+/// Worlds are independent of each other, each with its own particles,
+/// textures, clock and random numbers. A world is stepped once per frame
+/// by the application. After a step, the height texture holds the water
+/// of that tick, as RGB32F texels: xy is the horizontal displacement, z
+/// the height. The simulation domain [-1,1]^2 maps onto the texture
+/// coordinates [0,1]^2.
+///
+/// The C++ interface is World.h.
+///
+
+#pragma once
+
+// STANDARD
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct wp_world wp_world;
+
+// returns the address of the GL function `name`, e.g. glfwGetProcAddress
+typedef void* (*wp_gl_loader)(const char* name);
+
+// a zeroed struct selects the defaults
+typedef struct wp_world_desc
+{
+	const char* shader_root;      // the 'shaders' directory, '|' separated, NULL for "..|shaders"
+	int texture_size;             // resolution of the height texture, 0 for 128
+	double time_step;             // simulated seconds per step, 0 for the wall-clock time
+	uint32_t seed;                // random seed of the world, 0 for a random one
+	size_t particle_budget;       // largest number of particles, 0 for the default
+
+	// optional terrain, terrain_size x terrain_size heights, row-major.
+	// Fields below sea_level - shallow_depth are ocean, above sea_level land.
+	const float* terrain_heights;
+	int terrain_size;
+	float sea_level;
+	float shallow_depth;
+} wp_world_desc;
+
+// a particle leaving (x, y) at wp_world_get_time, i.e. the time of the last
+// step. It is added at the next step, and has moved on by then.
+typedef struct wp_particle
+{
+	float x, y;                   // position in [-1,1]^2
+	float direction;              // propagation angle, radians
+	float dispersion_angle;       // radians, 0 for a single particle, 2 pi for a ring
+	float velocity;               // domain units per second
+	float amplitude;              // signed
+	float radius;                 // domain units
+} wp_particle;
+
+// the heights of the query `ticket`, valid only during the call
+typedef void (*wp_height_callback)(void* user, uint64_t ticket, const float* heights, size_t count);
+
+// loads the GL entry points through the application's loader, returns 0 on failure
+int wp_load_gl(wp_gl_loader loader);
+
+wp_world* wp_world_create(const wp_world_desc* desc);
+void wp_world_destroy(wp_world* world);
+
+// adds the particles at the next step, see wp_particle
+void wp_world_emit(wp_world* world, const wp_particle* particles, size_t count);
+
+// one tick of the simulation. Every piece of GL state it changes is
+// restored afterwards: the viewport, the framebuffer, polygon mode, blending
+// (enable, function, equation), GL_PROGRAM_POINT_SIZE,
+// GL_RASTERIZER_DISCARD, the program, the vertex array, the array,
+// uniform (generic, and indexed 0 and 1) and transform feedback (generic,
+// and indexed 0 to 2) buffer bindings, the active texture unit, and the
+// 2D textures of units 0 to 2.
+void wp_world_step(wp_world* world);
+
+// one tick of each of `count` worlds, e.g. an ocean and its lakes. Worlds
+// created with the same shader root are stepped in shared passes, which
+// binds every program once instead of once per world. Restores the same
+// GL state as wp_world_step.
+void wp_world_step_all(wp_world* const* worlds, size_t count);
+
+unsigned int wp_world_get_height_texture(const wp_world* world);
+int wp_world_get_texture_size(const wp_world* world);
+size_t wp_world_get_num_particles(const wp_world* world);
+double wp_world_get_time(const wp_world* world);
+
+// queues the heights at `count` (x, y) pairs, sampled from the height
+// texture at the next step. Returns the ticket wp_world_poll_heights reports
+// them with, or 0 if too many queries are in flight.
+uint64_t wp_world_query_heights(wp_world* world, const float* positions, size_t count);
+
+// reports every query whose results have arrived, usually a frame or two
+// later, in ticket order
+void wp_world_poll_heights(wp_world* world, wp_height_callback callback, void* user);
+
+// exact heights at `count` (x, y) pairs right away, computed from the
+// particles. Only with CPU propagation, returns 0 otherwise.
+int wp_world_evaluate_heights(const wp_world* world, const float* positions, float* heights,
+	size_t count);
+
+// propagation on the CPU (event-driven) instead of by transform feedback
+void wp_world_set_cpu_propagation(wp_world* world, int enabled);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,948 @@
+///
+/// World
+///
+/// One wave particle simulation: the particle buffers, the distribution
+/// texture the particles are splatted into, the terrain the particles
+/// reflect at, its clock, and its parameters. Everything main() used to
+/// keep in locals, such that the simulation can be driven by any
+/// application with a current GL context, see WaveParticlesLib.h.
+///
+/// Worlds are independent of each other, down to their random numbers, so
+/// any number of them can run in one process, e.g. lakes next to the ocean,
+/// or several sessions on one server. The shader programs do not depend on
+/// the world, and are shared by all worlds through WorldPrograms.
+///
+/// A step runs one tick:
+///   - particles emitted since the last step are added
+///   - propagation, by transform feedback, or on the CPU (see
+///     EventDrivenPropagation.h)
+///   - particles that left through an open border of the domain are
+///     collected, see TiledWorld.h
+///   - the distribution texture is cleared, and the particles are splatted
+///     into it
+///   - submitted height queries are evaluated (see HeightQuery.h)
+/// StepAll steps many worlds at once, phase by phase, such that each
+/// program is bound once for all worlds rather than once per world (see
+/// also WorldScheduler.h, and TiledWorld.h). All GL state a step changes is
+/// restored afterwards, see HostState, so the host's own rendering is not
+/// affected.
+///
+
+#pragma once
+
+// STANDARD
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <random>
+
+// CUSTOM
+#include "OpenGL.h"
+#include "Particle.h"
+#include "RandomGenerator.h"
+#include "ParticleBuffer.h"
+#include "ShaderManager.h"
+#include "ShaderWrapper.h"
+#include "ShaderPreprocessor.h"
+#include "UniformBuffer.h"
+#include "SimulationUniforms.h"
+#include "SimulationClock.h"
+#include "HeightMap.h"
+#include "HeightMapTexture.h"
+#include "SignedDistanceField.h"
+#include "SignedDistanceFieldTexture.h"
+#include "EventDrivenPropagation.h"
+#include "HeightQuery.h"
+#include "HeightEvaluator.h"
+
+
+namespace Simulation
+{
+	struct WorldSettings
+	{
+		// the 'shaders' directory, with '|' as separator (see FileIO.h)
+		std::string ShaderRoot = "..|shaders";
+
+		// resolution of the distribution texture, N x N texels
+		int TextureSize = 128;
+
+		// each subdividing particle becomes this many particles
+		int MaxSubdivisionBranches = 3;
+
+		// the particle buffers grow on demand, up to the budget. Beyond that,
+		// subdivision is paused rather than losing particles.
+		size_t InitialParticleCapacity = 200000;
+		size_t ParticleBudget = 1 << 22;
+
+		// simulated seconds per step, or 0 for the wall-clock time
+		double TimeStep = 0.0;
+
+		// fields, see SignedDistanceField.h
+		GLfloat ShoreMaxDistance = 16.0f;
+
+		// random numbers of the world, different every run by default
+		uint32_t Seed = std::random_device{}();
+	};
+
+	// texture units used during a step
+	static constexpr GLuint WORLD_TERRAIN_TEXTURE_UNIT = 1;
+	static constexpr GLuint WORLD_SHORE_DISTANCE_TEXTURE_UNIT = 2;
+
+	class WorldPrograms
+	{
+	private:
+		Core::Shaders::ShaderManager _shaderManager;
+
+	public:
+		Core::Shaders::ShaderWrapper& Cleanup;
+		Core::Shaders::ShaderWrapper& Blending;
+		Core::Shaders::ShaderWrapper& Propagation;
+		Core::Shaders::ShaderWrapper& HeightQuery;
+		Core::Shaders::ShaderWrapper& Migration;
+
+		// submits all programs at once, such that the driver can compile them
+		// in parallel (see ShaderManager). Also points the shared include
+		// directory at `shaderRoot`|include, before the first program needs it.
+		WorldPrograms(const std::string& shaderRoot, int maxSubdivisionBranches)
+			: Cleanup(_shaderManager.Submit(
+				(setIncludeDirectory(shaderRoot) + "|waveParticles|distributionTextureCleanup").c_str(),
+				Core::Shaders::SHADER_TYPE_VF)),
+			Blending(_shaderManager.Submit((shaderRoot + "|waveParticles|particleBlending").c_str(),
+				Core::Shaders::SHADER_TYPE_VF, { { "BLENDING_KERNEL", "BLENDING_KERNEL_COSINE" } })),
+			Propagation(_shaderManager.Submit((shaderRoot + "|waveParticles|particlePropagation").c_str(),
+				Core::Shaders::TF_SHADER_TYPE_VG, particleOutputs, 3,
+				{ { "MAX_SUBDIVISION_BRANCHES", std::to_string(maxSubdivisionBranches) } })),
+			HeightQuery(_shaderManager.Submit((shaderRoot + "|waveParticles|heightQuery").c_str(),
+				Core::Shaders::TF_SHADER_TYPE_V, heightQueryOutputs, 1)),
+			Migration(_shaderManager.Submit((shaderRoot + "|waveParticles|particleMigration").c_str(),
+				Core::Shaders::TF_SHADER_TYPE_VG, particleOutputs, 3))
+		{
+			_shaderManager.BindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+			_shaderManager.BindUniformBlock("SimulationParameters", SIMULATION_PARAMETERS_BINDING);
+
+			Propagation.Activate();
+			Propagation.SetUniformTexture("terrainTexture", WORLD_TERRAIN_TEXTURE_UNIT);
+			Propagation.SetUniformTexture("shoreDistanceTexture", WORLD_SHORE_DISTANCE_TEXTURE_UNIT);
+			Propagation.Deactivate();
+		}
+
+		WorldPrograms(const WorldPrograms&) = delete;
+		WorldPrograms& operator= (const WorldPrograms&) = delete;
+
+		// e.g. for hot reload, see ShaderManager::EnableHotReload
+		Core::Shaders::ShaderManager& GetShaderManager() { return _shaderManager; }
+
+	private:
+		static inline const GLchar* particleOutputs[] = { "paramVec1", "paramVec2", "paramVec3" };
+		static inline const GLchar* heightQueryOutputs[] = { "height" };
+
+		static const std::string& setIncludeDirectory(const std::string& shaderRoot)
+		{
+			Core::Shaders::SetShaderIncludeDirectory((shaderRoot + "|include").c_str());
+			return shaderRoot;
+		}
+	};
+
+	class World
+	{
+	private:
+		// the GL state of the caller that a step overwrites, saved before and
+		// restored after StepAll
+		struct HostState
+		{
+			static constexpr GLuint NUM_TEXTURE_UNITS = WORLD_SHORE_DISTANCE_TEXTURE_UNIT + 1;
+			static constexpr GLuint NUM_FEEDBACK_BUFFERS = 3;
+
+			GLint Viewport[4];
+			GLint Framebuffer;
+			GLint PolygonMode[2];
+			GLboolean Blend;
+			GLboolean ProgramPointSize;
+			GLboolean RasterizerDiscard;
+			GLint BlendSourceRgb, BlendDestinationRgb, BlendSourceAlpha, BlendDestinationAlpha;
+			GLint BlendEquationRgb, BlendEquationAlpha;
+			GLint Program;
+			GLint VertexArray;
+			GLint ArrayBuffer;
+			GLint UniformBuffer;
+			GLint UniformBuffers[2]; // FRAME_UNIFORMS_BINDING, SIMULATION_PARAMETERS_BINDING
+			GLint TransformFeedbackBuffer;
+			GLint TransformFeedbackBuffers[NUM_FEEDBACK_BUFFERS];
+			GLint ActiveTexture;
+			GLint Textures[NUM_TEXTURE_UNITS];
+
+			void Save()
+			{
+				glGetIntegerv(GL_VIEWPORT, Viewport);
+				glGetIntegerv(GL_FRAMEBUFFER_BINDING, &Framebuffer);
+				glGetIntegerv(GL_POLYGON_MODE, PolygonMode);
+				Blend = glIsEnabled(GL_BLEND);
+				ProgramPointSize = glIsEnabled(GL_PROGRAM_POINT_SIZE);
+				RasterizerDiscard = glIsEnabled(GL_RASTERIZER_DISCARD);
+				glGetIntegerv(GL_BLEND_SRC_RGB, &BlendSourceRgb);
+				glGetIntegerv(GL_BLEND_DST_RGB, &BlendDestinationRgb);
+				glGetIntegerv(GL_BLEND_SRC_ALPHA, &BlendSourceAlpha);
+				glGetIntegerv(GL_BLEND_DST_ALPHA, &BlendDestinationAlpha);
+				glGetIntegerv(GL_BLEND_EQUATION_RGB, &BlendEquationRgb);
+				glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &BlendEquationAlpha);
+				glGetIntegerv(GL_CURRENT_PROGRAM, &Program);
+				glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &VertexArray);
+				glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &ArrayBuffer);
+				glGetIntegerv(GL_UNIFORM_BUFFER_BINDING, &UniformBuffer);
+				glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, FRAME_UNIFORMS_BINDING, &UniformBuffers[0]);
+				glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, SIMULATION_PARAMETERS_BINDING,
+					&UniformBuffers[1]);
+				glGetIntegerv(GL_TRANSFORM_FEEDBACK_BUFFER_BINDING, &TransformFeedbackBuffer);
+				for (GLuint i = 0; i < NUM_FEEDBACK_BUFFERS; i++)
+				{
+					glGetIntegeri_v(GL_TRANSFORM_FEEDBACK_BUFFER_BINDING, i, &TransformFeedbackBuffers[i]);
+				}
+				glGetIntegerv(GL_ACTIVE_TEXTURE, &ActiveTexture);
+				for (GLuint unit = 0; unit < NUM_TEXTURE_UNITS; unit++)
+				{
+					glActiveTexture(GL_TEXTURE0 + unit);
+					glGetIntegerv(GL_TEXTURE_BINDING_2D, &Textures[unit]);
+				}
+				glActiveTexture((GLenum)ActiveTexture);
+			}
+
+			void Restore() const
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+				glViewport(Viewport[0], Viewport[1], Viewport[2], Viewport[3]);
+				glPolygonMode(GL_FRONT_AND_BACK, PolygonMode[0]);
+				if (Blend) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+				if (ProgramPointSize) glEnable(GL_PROGRAM_POINT_SIZE); else glDisable(GL_PROGRAM_POINT_SIZE);
+				if (RasterizerDiscard) glEnable(GL_RASTERIZER_DISCARD); else glDisable(GL_RASTERIZER_DISCARD);
+				glBlendFuncSeparate(BlendSourceRgb, BlendDestinationRgb, BlendSourceAlpha,
+					BlendDestinationAlpha);
+				glBlendEquationSeparate(BlendEquationRgb, BlendEquationAlpha);
+				glUseProgram(Program);
+				glBindVertexArray(VertexArray);
+				glBindBuffer(GL_ARRAY_BUFFER, ArrayBuffer);
+				glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, UniformBuffers[0]);
+				glBindBufferBase(GL_UNIFORM_BUFFER, SIMULATION_PARAMETERS_BINDING, UniformBuffers[1]);
+				glBindBuffer(GL_UNIFORM_BUFFER, UniformBuffer);
+				for (GLuint i = 0; i < NUM_FEEDBACK_BUFFERS; i++)
+				{
+					glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, i, TransformFeedbackBuffers[i]);
+				}
+				glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, TransformFeedbackBuffer);
+				for (GLuint unit = 0; unit < NUM_TEXTURE_UNITS; unit++)
+				{
+					glActiveTexture(GL_TEXTURE0 + unit);
+					glBindTexture(GL_TEXTURE_2D, Textures[unit]);
+				}
+				glActiveTexture((GLenum)ActiveTexture);
+			}
+		};
+
+		// wave fronts finer than the LevelOfDetailView allows are merged back
+		// this often, in CPU mode
+		static constexpr double LOD_INTERVAL = 0.25;
+
+		// particles leaving through open borders are read back a step or two
+		// later, from one of these slots, such that nothing waits for the GPU
+		static constexpr int NUM_TRANSFER_SLOTS = 3;
+		static constexpr size_t INITIAL_TRANSFER_CAPACITY = 1024;
+
+		struct TransferSlot
+		{
+			GLuint Buffer = 0;
+			size_t Capacity = 0;       // particles
+			GLuint WrittenQuery = 0;
+			GLsync Fence = nullptr;    // in flight while set
+		};
+
+		WorldPrograms& _programs;
+		WorldSettings _settings;
+
+		// simulation state
+		SimulationClock _clock;
+		uint32_t _seed;
+		Utilities::CounterRandom _random;
+		bool _propagate = true;      // random particles are rings, see EmitRandom
+		bool _createRemote = false;  // random particles start outside of the domain
+		SimulationParameters _parameters;
+		bool _parametersChanged = false;
+		FrameUniforms _frameUniforms = {};
+		Core::Shaders::UniformBuffer<FrameUniforms> _frameUniformBuffer;
+		Core::Shaders::UniformBuffer<SimulationParameters> _parameterBuffer;
+
+		// particles, ping-ponged by the propagation pass
+		ParticleBuffer _particleBuffer;
+		int _read = 0;
+		int _write = 1;
+		GLuint _numParticles = 0;
+		GLuint _vao;
+		GLuint _particlesWrittenQuery;
+		GLuint _particlesGeneratedQuery;
+		std::vector<PackedWaveParticle> _pendingParticles;
+
+		// particles that left through an open border, see GetOutgoingParticles
+		TransferSlot _transferSlots[NUM_TRANSFER_SLOTS];
+		int _nextTransferSlot = 0;    // the oldest slot in flight, if any
+		int _numTransfersInFlight = 0;
+		std::vector<PackedWaveParticle> _outgoingParticles;
+
+		// wave particle distribution texture
+		GLuint _texture;
+		GLuint _framebuffer;
+		GLuint _cleanupVAO;
+		GLuint _cleanupVBO;
+
+		// terrain, nullptr is open ocean
+		Terrain::HeightMap* _terrain;
+		Terrain::HeightMapTexture* _terrainTexture;
+		Terrain::SignedDistanceField* _shoreDistanceField;
+		Terrain::SignedDistanceFieldTexture* _shoreDistanceTexture;
+
+		// event-driven propagation on the CPU
+		EventDrivenPropagation _eventPropagation;
+		std::vector<PackedWaveParticle> _cpuParticles;
+		bool _cpuPropagation = false;
+		bool _cpuPropagationActive = false;
+		LevelOfDetailView _levelOfDetailView;
+		bool _hasLevelOfDetailView = false;
+		double _lastLevelOfDetailTime = 0.0;
+
+		// height queries, see GetHeights and SubmitHeightQuery
+		HeightQuery _heightQuery;
+		HeightEvaluator _heightEvaluator;
+
+		static SimulationClock createClock(double timeStep)
+		{
+			return (timeStep > 0.0) ? SimulationClock(timeStep) : SimulationClock();
+		}
+
+		static void bindParticleAttributes(GLuint buffer)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+			// (Position.x, Position.y, PropagationAngle, DispersionAngle)
+			glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
+				(GLvoid*)0);
+			glEnableVertexAttribArray(0);
+
+			// (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
+			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
+				(GLvoid*)(sizeof(glm::vec4)));
+			glEnableVertexAttribArray(1);
+
+			// (Radius, Amplitude, nBorderFrames)
+			glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(PackedWaveParticle),
+				(GLvoid*)(2 * sizeof(glm::vec4)));
+			glEnableVertexAttribArray(2);
+		}
+
+		void applyParameters()
+		{
+			_parameterBuffer.Update(_parameters);
+			_eventPropagation.SetParameters(_parameters);
+			_parametersChanged = false;
+		}
+
+		// the first `count` particles of the read buffer, into `_cpuParticles`
+		void readBack(size_t count)
+		{
+			_cpuParticles.resize(count);
+			glBindBuffer(GL_ARRAY_BUFFER, _particleBuffer.GetBuffer(_read));
+			glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(PackedWaveParticle),
+				_cpuParticles.data());
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		// particles emitted since the last step, appended in a single upload
+		void addPendingParticles(double time)
+		{
+			if (_pendingParticles.empty()) return;
+
+			if (_cpuPropagation)
+			{
+				for (const PackedWaveParticle& particle : _pendingParticles)
+				{
+					_eventPropagation.Emit(particle, time);
+				}
+			}
+			else
+			{
+				size_t count = _pendingParticles.size();
+				if (!_particleBuffer.Reserve(_numParticles + count, _read, _numParticles))
+				{
+					count = _particleBuffer.GetCapacity() - std::min<size_t>(_numParticles,
+						_particleBuffer.GetCapacity());
+					std::cout << "Particle budget reached, not spawning" << std::endl;
+				}
+				if (count > 0)
+				{
+					glBindBuffer(GL_ARRAY_BUFFER, _particleBuffer.GetBuffer(_read));
+					glBufferSubData(GL_ARRAY_BUFFER, _numParticles * sizeof(PackedWaveParticle),
+						count * sizeof(PackedWaveParticle), _pendingParticles.data());
+					glBindBuffer(GL_ARRAY_BUFFER, 0);
+					_numParticles += (GLuint)count;
+				}
+			}
+			_pendingParticles.clear();
+		}
+
+		// only particles with a due event do any work
+		void propagateOnCpu(double time)
+		{
+			_eventPropagation.Advance(time);
+			if (_hasLevelOfDetailView && std::abs(time - _lastLevelOfDetailTime) > LOD_INTERVAL)
+			{
+				_eventPropagation.UpdateLevelOfDetail(_levelOfDetailView);
+				_lastLevelOfDetailTime = time;
+			}
+
+			// every particle could subdivide during the next Advance
+			const size_t budget = _particleBuffer.GetBudget();
+			if (_parameters.subdivisionEnabled != 0.0f &&
+				_eventPropagation.GetNumParticles() * _settings.MaxSubdivisionBranches > budget)
+			{
+				_parameters.subdivisionEnabled = 0.0f;
+				_parametersChanged = true;
+				std::cout << "Particle budget reached, subdivision paused" << std::endl;
+			}
+
+			_cpuParticles.resize(std::min(_eventPropagation.GetNumParticles(), budget));
+			_particleBuffer.Reserve(_cpuParticles.size(), _write, 0);
+			_numParticles = (GLuint)_eventPropagation.WritePackedParticles(
+				_cpuParticles.data(), _cpuParticles.size());
+
+			// exact heights of this tick, without asking the GPU
+			_heightEvaluator.Rebuild(_cpuParticles.data(), _numParticles);
+
+			glBindBuffer(GL_ARRAY_BUFFER, _particleBuffer.GetBuffer(_write));
+			glBufferSubData(GL_ARRAY_BUFFER, 0, _numParticles * sizeof(PackedWaveParticle),
+				_cpuParticles.data());
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		// transform feedback from the read into the write buffer. Expects the
+		// propagation program to be active, and rasterization to be disabled.
+		void propagateOnGpu()
+		{
+			glBindVertexArray(_vao);
+			_frameUniformBuffer.Bind();
+			_parameterBuffer.Bind();
+			_terrainTexture->Bind(WORLD_TERRAIN_TEXTURE_UNIT);
+			_shoreDistanceTexture->Bind(WORLD_SHORE_DISTANCE_TEXTURE_UNIT);
+			glActiveTexture(GL_TEXTURE0);
+
+			// replayed from the same input, until the output fits
+			const GLuint numInput = _numParticles;
+			GLuint numGenerated = 0;
+			while (true)
+			{
+				bindParticleAttributes(_particleBuffer.GetBuffer(_read));
+
+				const GLuint output = _particleBuffer.GetBuffer(_write);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, output);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, output);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 2, output);
+
+				glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, _particlesWrittenQuery);
+				glBeginQuery(GL_PRIMITIVES_GENERATED, _particlesGeneratedQuery);
+				glBeginTransformFeedback(GL_POINTS);
+				glDrawArrays(GL_POINTS, 0, numInput);
+				glEndTransformFeedback();
+				glEndQuery(GL_PRIMITIVES_GENERATED);
+				glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+
+				glGetQueryObjectuiv(_particlesWrittenQuery, GL_QUERY_RESULT, &_numParticles);
+				glGetQueryObjectuiv(_particlesGeneratedQuery, GL_QUERY_RESULT, &numGenerated);
+				if (numGenerated <= _numParticles) break;
+
+				// OUTPUT DID NOT FIT: grow the buffers, or once the budget is
+				// exhausted, pause subdivision, and run the same pass again
+				if (!_particleBuffer.Reserve(numGenerated, _read, numInput))
+				{
+					// without subdivision, every particle is written at most once
+					if (_parameters.subdivisionEnabled == 0.0f) break;
+					_parameters.subdivisionEnabled = 0.0f;
+					applyParameters();
+					std::cout << "Particle budget reached, subdivision paused" << std::endl;
+				}
+			}
+
+		}
+
+		// captures the particles beyond an open border into the next transfer
+		// slot. Expects the migration program to be active, and rasterization
+		// to be disabled.
+		void collectOutgoing()
+		{
+			// all slots in flight, only after a few very short frames
+			if (_numTransfersInFlight == NUM_TRANSFER_SLOTS) receiveOutgoing(true);
+
+			TransferSlot& slot = _transferSlots[
+				(_nextTransferSlot + _numTransfersInFlight) % NUM_TRANSFER_SLOTS];
+
+			// room for every particle, such that the output always fits, and
+			// the count need not be waited for
+			if (slot.Capacity < _numParticles || slot.Capacity == 0)
+			{
+				slot.Capacity = std::max<size_t>({ _numParticles, 2 * slot.Capacity,
+					INITIAL_TRANSFER_CAPACITY });
+				glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, slot.Buffer);
+				glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER,
+					slot.Capacity * sizeof(PackedWaveParticle), nullptr, GL_STREAM_READ);
+			}
+
+			glBindVertexArray(_vao);
+			_frameUniformBuffer.Bind();
+			bindParticleAttributes(_particleBuffer.GetBuffer(_write));
+			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, slot.Buffer);
+
+			glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, slot.WrittenQuery);
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS, 0, _numParticles);
+			glEndTransformFeedback();
+			glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+
+			slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			_numTransfersInFlight++;
+		}
+
+		// appends the particles of every transfer slot that has arrived to
+		// `_outgoingParticles`, oldest first. With `wait`, waits for the
+		// oldest slot in flight.
+		void receiveOutgoing(bool wait)
+		{
+			while (_numTransfersInFlight > 0)
+			{
+				TransferSlot& slot = _transferSlots[_nextTransferSlot];
+				const GLuint64 timeout = wait ? GL_TIMEOUT_IGNORED : 0;
+				const GLenum status = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+					timeout);
+				if (status == GL_TIMEOUT_EXPIRED) return;
+				wait = false;
+
+				glDeleteSync(slot.Fence);
+				slot.Fence = nullptr;
+				_nextTransferSlot = (_nextTransferSlot + 1) % NUM_TRANSFER_SLOTS;
+				_numTransfersInFlight--;
+				if (status == GL_WAIT_FAILED) continue;
+
+				// the query ended before the fence, so its result is available
+				GLuint count = 0;
+				glGetQueryObjectuiv(slot.WrittenQuery, GL_QUERY_RESULT, &count);
+				if (count == 0) continue;
+
+				glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, slot.Buffer);
+				const PackedWaveParticle* particles = (const PackedWaveParticle*)glMapBufferRange(
+					GL_TRANSFORM_FEEDBACK_BUFFER, 0, count * sizeof(PackedWaveParticle),
+					GL_MAP_READ_BIT);
+				if (particles != nullptr)
+				{
+					_outgoingParticles.insert(_outgoingParticles.end(), particles, particles + count);
+					glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+				}
+				glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+			}
+		}
+
+		bool hasOpenBorders() const
+		{
+			return _frameUniforms.openBorders != glm::vec4(0.0f);
+		}
+
+		// clears the distribution texture, with the cleanup program active
+		void clearDistribution()
+		{
+			glViewport(0, 0, _settings.TextureSize, _settings.TextureSize);
+			glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+			glBindVertexArray(_cleanupVAO);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		}
+
+		// splats the written particles into the distribution texture, with the
+		// blending program active and additive blending enabled
+		void splatDistribution()
+		{
+			glViewport(0, 0, _settings.TextureSize, _settings.TextureSize);
+			glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+			glBindVertexArray(_vao);
+			bindParticleAttributes(_particleBuffer.GetBuffer(_write));
+			glDrawArrays(GL_POINTS, 0, _numParticles);
+		}
+
+		// everything of a step before the GPU passes. With `clock`, the world
+		// steps to its tick and time, rather than ticking its own clock.
+		void beginStep(const SimulationClock* clock)
+		{
+			if (clock != nullptr) _clock = *clock;
+			else _clock.Tick();
+			const double time = _clock.GetTime();
+			_outgoingParticles.clear();
+
+			// resume subdividing once even the worst case fits into the budget again
+			if (_parameters.subdivisionEnabled == 0.0f &&
+				(size_t)_numParticles * _settings.MaxSubdivisionBranches <=
+				_particleBuffer.GetBudget() / 2)
+			{
+				_parameters.subdivisionEnabled = 1.0f;
+				_parametersChanged = true;
+			}
+			if (_parametersChanged) applyParameters();
+
+			_frameUniforms.time = (GLfloat)time;
+			_frameUniformBuffer.Update(_frameUniforms);
+
+			// HAND OVER PARTICLES WHEN SWITCHING TO CPU PROPAGATION
+			// (the other way round, the last upload is already in the read buffer)
+			if (_cpuPropagation && !_cpuPropagationActive)
+			{
+				readBack(_numParticles);
+				_eventPropagation.Clear(time);
+				for (const PackedWaveParticle& particle : _cpuParticles)
+				{
+					_eventPropagation.Emit(particle, time);
+				}
+			}
+			_cpuPropagationActive = _cpuPropagation;
+
+			addPendingParticles(time);
+			if (_cpuPropagation) propagateOnCpu(time);
+		}
+
+		// everything of a step after the distribution texture is complete
+		void endStep()
+		{
+			_heightQuery.Evaluate(_programs.HeightQuery, _texture);
+
+			receiveOutgoing(false);
+
+			// SWAPPING TF BUFFERS, the read buffer holds this tick's particles
+			std::swap(_read, _write);
+		}
+
+	public:
+		// takes ownership of `terrain`, which may be nullptr for open ocean.
+		// The field types of the terrain must be classified already.
+		World(WorldPrograms& programs, const WorldSettings& settings,
+			Terrain::HeightMap* terrain = nullptr)
+			: _programs(programs), _settings(settings),
+			_clock(createClock(settings.TimeStep)),
+			_seed(settings.Seed),
+			_random(settings.Seed),
+			_frameUniformBuffer(FRAME_UNIFORMS_BINDING),
+			_parameterBuffer(SIMULATION_PARAMETERS_BINDING),
+			_particleBuffer(settings.InitialParticleCapacity, settings.ParticleBudget),
+			_terrain(terrain),
+			_eventPropagation(settings.MaxSubdivisionBranches, _parameters)
+		{
+			_parameterBuffer.Update(_parameters);
+			_frameUniforms.viewProjection = glm::mat4(1.0f);
+			_frameUniforms.mapSize = (GLfloat)settings.TextureSize;
+
+			glGenVertexArrays(1, &_vao);
+			glGenQueries(1, &_particlesWrittenQuery);
+			glGenQueries(1, &_particlesGeneratedQuery);
+			for (TransferSlot& slot : _transferSlots)
+			{
+				glGenBuffers(1, &slot.Buffer);
+				glGenQueries(1, &slot.WrittenQuery);
+			}
+
+			// WAVE PARTICLE DISTRIBUTION TEXTURE
+			glGenTextures(1, &_texture);
+			glBindTexture(GL_TEXTURE_2D, _texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, settings.TextureSize, settings.TextureSize,
+				0, GL_RGB, GL_FLOAT, nullptr);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			GLint previousFramebuffer;
+			glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+			glGenFramebuffers(1, &_framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _texture, 0);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			{
+				std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+			// full-screen quad clearing the texture
+			const GLfloat cleanupQuadData[] = {
+				-1.0f, 1.0f,   1.0f, 1.0f,   -1.0f, -1.0f,
+				1.0f, 1.0f,    1.0f, -1.0f,  -1.0f, -1.0f
+			};
+			glGenVertexArrays(1, &_cleanupVAO);
+			glBindVertexArray(_cleanupVAO);
+			glGenBuffers(1, &_cleanupVBO);
+			glBindBuffer(GL_ARRAY_BUFFER, _cleanupVBO);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(cleanupQuadData), cleanupQuadData, GL_STATIC_DRAW);
+			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+			glEnableVertexAttribArray(0);
+			glBindVertexArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			// TERRAIN, collision and shore normal in a single lookup
+			if (_terrain == nullptr)
+			{
+				_terrain = new Terrain::HeightMap(settings.TextureSize);
+			}
+			_terrainTexture = new Terrain::HeightMapTexture(*_terrain);
+			_shoreDistanceField = new Terrain::SignedDistanceField(*_terrain,
+				settings.ShoreMaxDistance);
+			_shoreDistanceTexture = new Terrain::SignedDistanceFieldTexture(*_shoreDistanceField);
+
+			_eventPropagation.Clear(_clock.GetTime());
+			_eventPropagation.SetShore(_shoreDistanceField);
+		}
+
+		~World()
+		{
+			delete _shoreDistanceTexture;
+			delete _shoreDistanceField;
+			delete _terrainTexture;
+			delete _terrain;
+			glDeleteBuffers(1, &_cleanupVBO);
+			glDeleteVertexArrays(1, &_cleanupVAO);
+			glDeleteFramebuffers(1, &_framebuffer);
+			glDeleteTextures(1, &_texture);
+			glDeleteQueries(1, &_particlesWrittenQuery);
+			glDeleteQueries(1, &_particlesGeneratedQuery);
+			for (TransferSlot& slot : _transferSlots)
+			{
+				if (slot.Fence != nullptr) glDeleteSync(slot.Fence);
+				glDeleteQueries(1, &slot.WrittenQuery);
+				glDeleteBuffers(1, &slot.Buffer);
+			}
+			glDeleteVertexArrays(1, &_vao);
+		}
+
+		World(const World&) = delete;
+		World& operator= (const World&) = delete;
+
+		// adds `particle` at the next step. Its TimeAtOrigin (paramVec2.z) is
+		// on this world's clock, see GetClock.
+		void Emit(const PackedWaveParticle& particle)
+		{
+			_pendingParticles.push_back(particle);
+		}
+
+		// one tick of the simulation, see the top of this file
+		void Step()
+		{
+			World* world = this;
+			StepAll(&world, 1);
+		}
+
+		// one tick of each of the `count` worlds, which must share their
+		// programs. Each pass runs for all worlds before the next one. With
+		// `clock`, all worlds step to its tick and time, see beginStep.
+		static void StepAll(World* const* worlds, size_t count,
+			const SimulationClock* clock = nullptr)
+		{
+			if (count == 0) return;
+			WorldPrograms& programs = worlds[0]->_programs;
+
+			HostState hostState;
+			hostState.Save();
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+			// CPU propagation, and particles emitted since the last step
+			bool isPropagatingOnGpu = false;
+			bool isMigrating = false;
+			for (size_t i = 0; i < count; i++)
+			{
+				assert(&worlds[i]->_programs == &programs);
+				worlds[i]->beginStep(clock);
+				isPropagatingOnGpu |= !worlds[i]->_cpuPropagation;
+				isMigrating |= !worlds[i]->_cpuPropagation && worlds[i]->hasOpenBorders();
+			}
+
+			// PERFORM TRANSFORM FEEDBACK
+			if (isPropagatingOnGpu)
+			{
+				programs.Propagation.Activate();
+				glEnable(GL_RASTERIZER_DISCARD);
+				for (size_t i = 0; i < count; i++)
+				{
+					if (!worlds[i]->_cpuPropagation) worlds[i]->propagateOnGpu();
+				}
+				programs.Propagation.Deactivate();
+
+				// COLLECT PARTICLES LEAVING THROUGH OPEN BORDERS
+				if (isMigrating)
+				{
+					programs.Migration.Activate();
+					for (size_t i = 0; i < count; i++)
+					{
+						if (!worlds[i]->_cpuPropagation && worlds[i]->hasOpenBorders())
+						{
+							worlds[i]->collectOutgoing();
+						}
+					}
+					programs.Migration.Deactivate();
+				}
+				glDisable(GL_RASTERIZER_DISCARD);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 1, 0);
+				glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 2, 0);
+			}
+
+			// CLEAN WAVE PARTICLE DISTRIBUTION TEXTURES
+			programs.Cleanup.Activate();
+			for (size_t i = 0; i < count; i++) worlds[i]->clearDistribution();
+			programs.Cleanup.Deactivate();
+
+			// RENDER WAVE PARTICLE DISTRIBUTION TEXTURES, with additive
+			// blending, such that overlapping particles add up
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+			glBlendEquation(GL_FUNC_ADD);
+			glEnable(GL_PROGRAM_POINT_SIZE);
+			programs.Blending.Activate();
+			for (size_t i = 0; i < count; i++) worlds[i]->splatDistribution();
+			programs.Blending.Deactivate();
+			glDisable(GL_BLEND);
+			glDisable(GL_PROGRAM_POINT_SIZE);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glBindVertexArray(0);
+
+			for (size_t i = 0; i < count; i++) worlds[i]->endStep();
+
+			hostState.Restore();
+		}
+
+		// a random particle at the next step, from the world's own random
+		// numbers (see GenerateRandom)
+		void EmitRandom()
+		{
+			PackedWaveParticle particle;
+			PackedWaveParticle::GenerateRandom(particle, (GLfloat)_clock.GetTime(), _random,
+				_propagate, _createRemote);
+			Emit(particle);
+		}
+
+		void SetPropagate(bool value) { _propagate = value; }
+		void SetCreateRemote(bool value) { _createRemote = value; }
+		bool IsPropagating() const { return _propagate; }
+		bool IsCreatingRemote() const { return _createRemote; }
+
+		// borders of the domain that lead into a neighbouring tile rather
+		// than reflecting, see TiledWorld.h. GPU propagation only, the
+		// event-driven propagation always reflects.
+		void SetOpenBorders(bool negativeX, bool positiveX, bool negativeY, bool positiveY)
+		{
+			_frameUniforms.openBorders = glm::vec4(negativeX, positiveX, negativeY, positiveY);
+		}
+
+		// the particles that left through an open border, beyond [-1,1]² in
+		// the coordinates of this world, whose transfer arrived during the
+		// last step. That is usually a step or two after they left.
+		const std::vector<PackedWaveParticle>& GetOutgoingParticles() const
+		{
+			return _outgoingParticles;
+		}
+
+		// no particles, none emitted since the last step, and no outgoing
+		// particles on their way back from the GPU
+		bool IsIdle() const
+		{
+			return _numParticles == 0 && _pendingParticles.empty() && _numTransfersInFlight == 0;
+		}
+
+		// the random numbers of the world, e.g. for more particles. Restoring
+		// the seed and the counter, e.g. from a snapshot, repeats the numbers.
+		Utilities::CounterRandom& GetRandom() { return _random; }
+		uint32_t GetSeed() const { return _seed; }
+		void SetRandom(uint32_t seed, uint32_t counter)
+		{
+			_seed = seed;
+			_random = Utilities::CounterRandom(seed);
+			_random.SetCounter(counter);
+		}
+
+		// replaces all particles by `count` records, e.g. from a snapshot.
+		// Returns false if they exceed the particle budget.
+		bool LoadParticles(const PackedWaveParticle* particles, size_t count)
+		{
+			if (!_particleBuffer.Reserve(count, _read, 0)) return false;
+			if (count > 0)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, _particleBuffer.GetBuffer(_read));
+				glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(PackedWaveParticle), particles);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			}
+			_numParticles = (GLuint)count;
+			_pendingParticles.clear();
+
+			// in CPU mode, the event-driven engine is rebuilt by the handover,
+			// which loses its bookkeeping, see Snapshot.h
+			_cpuPropagationActive = false;
+			return true;
+		}
+
+		// copies the particles after the last step into `particles`
+		void ReadParticles(std::vector<PackedWaveParticle>& particles)
+		{
+			readBack(_numParticles);
+			particles = _cpuParticles;
+		}
+
+		// CPU propagation takes effect at the next step
+		void SetCpuPropagation(bool enabled) { _cpuPropagation = enabled; }
+		bool IsCpuPropagation() const { return _cpuPropagation; }
+
+		// the view wave fronts are merged for, in CPU mode
+		void SetLevelOfDetailView(const LevelOfDetailView& view)
+		{
+			_levelOfDetailView = view;
+			_hasLevelOfDetailView = true;
+		}
+
+		// uploaded at the next step
+		void SetParameters(const SimulationParameters& parameters)
+		{
+			_parameters = parameters;
+			_parametersChanged = true;
+		}
+		const SimulationParameters& GetParameters() const { return _parameters; }
+
+		// queues the heights at `count` positions in [-1,1]², and returns the
+		// ticket PollHeightQueries reports them with, or 0 if all slots are busy.
+		// Sampled from the distribution texture, see HeightQuery.h.
+		uint64_t SubmitHeightQuery(const glm::vec2* positions, size_t count)
+		{
+			return _heightQuery.Submit(positions, count);
+		}
+
+		// calls `report(ticket, heights, count)` for every completed query, in
+		// ticket order
+		template<typename Function>
+		void PollHeightQueries(Function report)
+		{
+			_heightQuery.Poll(report);
+		}
+
+		// exact heights after the last step, right away. CPU propagation only,
+		// see HeightEvaluator.h. Returns false otherwise.
+		bool GetHeights(const glm::vec2* positions, GLfloat* heights, size_t count) const
+		{
+			if (!_cpuPropagationActive) return false;
+			_heightEvaluator.GetHeights(positions, heights, count);
+			return true;
+		}
+
+		SimulationClock& GetClock() { return _clock; }
+		const SimulationClock& GetClock() const { return _clock; }
+		GLuint GetHeightTexture() const { return _texture; }
+		GLuint GetDistributionFramebuffer() const { return _framebuffer; }
+		int GetTextureSize() const { return _settings.TextureSize; }
+		GLuint GetNumParticles() const { return _numParticles; }
+		size_t GetEventsProcessed() const { return _eventPropagation.GetEventsProcessed(); }
+
+		// the vertex buffer holding the GetNumParticles particles after the last step
+		GLuint GetParticleBuffer() const { return _particleBuffer.GetBuffer(_read); }
+	};
+}
@@ -0,0 +1,96 @@
+///
+/// World Scheduler
+///
+/// Steps many worlds once per frame, e.g. the ocean and a few lakes, or
+/// the sessions hosted by one server. All worlds due in a frame are
+/// stepped together with World::StepAll, so every pass binds its program
+/// once for all of them.
+///
+/// A world may be stepped only every n-th frame, e.g. a lake far from the
+/// camera. Its clock is ticked once for every frame since its last step,
+/// so it takes larger steps, and keeps time with the other worlds, also
+/// with a fixed time step. Worlds with the same interval are spread over
+/// the frames, such that not all of them are due in the same frame.
+///
+
+#pragma once
+
+// STANDARD
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// CUSTOM
+#include "World.h"
+
+
+namespace Simulation
+{
+	class WorldScheduler
+	{
+	private:
+		struct Entry
+		{
+			World* Instance;
+			uint32_t Interval; // frames per step
+			uint32_t Phase;    // the frame modulo Interval the world is due at
+			uint64_t Frame;    // the first frame its clock has not ticked for
+		};
+
+		std::vector<Entry> _entries;
+		std::vector<World*> _due; // scratch space of Step
+		uint64_t _frame = 0;
+
+	public:
+		// `world` is not owned, and must share its programs with all other worlds
+		void Add(World& world, uint32_t interval = 1)
+		{
+			interval = std::max(interval, 1u);
+			uint32_t phase = 0;
+			for (const Entry& entry : _entries)
+			{
+				if (entry.Interval == interval) phase++;
+			}
+			_entries.push_back({ &world, interval, phase % interval, _frame });
+		}
+
+		void Remove(World& world)
+		{
+			_entries.erase(std::remove_if(_entries.begin(), _entries.end(),
+				[&](const Entry& entry) { return entry.Instance == &world; }), _entries.end());
+		}
+
+		size_t GetNumWorlds() const { return _entries.size(); }
+		World& GetWorld(size_t index) { return *_entries[index].Instance; }
+
+		// steps the worlds due this frame, and returns how many there were
+		size_t Step()
+		{
+			_due.clear();
+			for (Entry& entry : _entries)
+			{
+				if (_frame % entry.Interval != entry.Phase) continue;
+
+				// the frames skipped, StepAll ticks once more for this one
+				SimulationClock& clock = entry.Instance->GetClock();
+				for (uint64_t frame = entry.Frame; frame < _frame; frame++) clock.Tick();
+				entry.Frame = _frame + 1;
+				_due.push_back(entry.Instance);
+			}
+			World::StepAll(_due.data(), _due.size());
+			_frame++;
+			return _due.size();
+		}
+
+		// summed over all worlds
+		size_t GetNumParticles() const
+		{
+			size_t count = 0;
+			for (const Entry& entry : _entries)
+			{
+				count += entry.Instance->GetNumParticles();
+			}
+			return count;
+		}
+	};
+}
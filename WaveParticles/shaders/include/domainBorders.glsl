@@ -0,0 +1,15 @@
+//
+// Borders of the simulation domain [-1, 1] x [-1, 1], see TiledWorld.h
+//
+// Particles reflect at closed borders. Open borders lead into the
+// neighbouring tile, which the particles migrate to instead.
+// Requires frameUniforms.glsl.
+//
+
+// per axis, whether `position` lies beyond an open border
+bvec2 beyondOpenBorder(vec2 position)
+{
+	return bvec2(
+		(position.x < -1.0f && openBorders.x != 0.0f) || (position.x > 1.0f && openBorders.y != 0.0f),
+		(position.y < -1.0f && openBorders.z != 0.0f) || (position.y > 1.0f && openBorders.w != 0.0f));
+}
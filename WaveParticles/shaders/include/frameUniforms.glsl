@@ -0,0 +1,12 @@
+//
+// Per-frame state, shared by all programs, see SimulationUniforms.h
+//
+
+layout (std140) uniform FrameUniforms
+{
+	mat4 viewProjection;
+	vec4 cameraPosition; // w unused
+	float time;
+	float mapSize;
+	vec4 openBorders;    // (-x, +x, -y, +y), 1 where the domain continues in a neighbouring tile
+};
@@ -0,0 +1,9 @@
+//
+// Wave particle vertex attributes, as bound by PackedWaveParticle
+//
+
+#include "particleLayout.glsl"
+
+layout (location = 0) in vec4 paramVec1;
+layout (location = 1) in vec4 paramVec2;
+layout (location = 2) in vec4 paramVec3;
@@ -0,0 +1,31 @@
+//
+// Wave particle layout, must match PackedWaveParticle (see Particle.h)
+//
+// paramVec1: (Position.x, Position.y, PropagationAngle, DispersionAngle)
+// paramVec2: (Origin.x, Origin.y, TimeAtOrigin, Velocity / AmplitudeSign)
+// paramVec3: (Radius, Amplitude, nBorderFrames)
+//
+
+// the sign of the amplitude is stored in the sign of the velocity, such that
+// a particle can be deleted when its damped amplitude changes sign
+float decodeVelocity(vec4 paramVec2)
+{
+	return abs(paramVec2.w);
+}
+
+float decodeAmplitudeSign(vec4 paramVec2)
+{
+	return sign(paramVec2.w);
+}
+
+float encodeVelocity(float velocity, float amplitudeSign)
+{
+	return velocity * amplitudeSign;
+}
+
+// position at `time`, moving from the origin along the propagation angle
+vec2 decodePosition(vec4 paramVec1, vec4 paramVec2, float time)
+{
+	float travelled = decodeVelocity(paramVec2) * (time - paramVec2.z);
+	return paramVec2.xy + travelled * vec2(cos(paramVec1.z), sin(paramVec1.z));
+}
@@ -0,0 +1,14 @@
+//
+// Simulation parameters, tunable at runtime without recompiling,
+// see SimulationUniforms.h
+//
+
+layout (std140) uniform SimulationParameters
+{
+	float dampingCoefficient;
+	float deletionAmplitude;
+	float subdivisionRadiusFactor;
+	float terrainReflection;       // 1 = reflect at land, 0 = absorb
+	float shallowWaterSpeedFactor; // speed over shallow water, relative to deep water
+	float subdivisionEnabled;      // 0 while the particle budget is exhausted
+};
@@ -0,0 +1,27 @@
+//
+// Terrain lookups, see HeightMapTexture.h
+//
+// The terrain texture covers the simulation domain [-1, 1] x [-1, 1].
+//
+
+// must match Terrain::HeightMapFieldType
+#define FIELD_TYPE_OCEAN 0
+#define FIELD_TYPE_SHALLOW_WATER 1
+#define FIELD_TYPE_LAND 2
+
+// (height, field type)
+uniform sampler2D terrainTexture;
+
+int fieldTypeAt(vec2 position)
+{
+	return int(texture(terrainTexture, position * 0.5f + 0.5f).g + 0.5f);
+}
+
+// (signed distance to the shoreline, normal pointing away from land),
+// negative distances are over land, see SignedDistanceFieldTexture.h
+uniform sampler2D shoreDistanceTexture;
+
+vec3 shoreAt(vec2 position)
+{
+	return texture(shoreDistanceTexture, position * 0.5f + 0.5f).xyz;
+}